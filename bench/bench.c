@@ -0,0 +1,258 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Benchmarks of the interpreter, run by `make bench`
+// Usage: bench path/to/east size_in_MB [flags]
+// Every benchmark runs east on a generated input (cached on $TMPDIR), the fastest of a few runs is reported
+// The results are tab separated, one benchmark per line, so runs of different builds can be compared with join or diff
+
+// fork, execv, waitpid, pipe and clock_gettime are POSIX
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define BENCH_ERR(msg) do {fprintf(stderr,"bench: %s\n", msg);exit(1);} while (0)
+
+// Runs of each benchmark, the fastest one counts
+#define BENCH_REPEAT 3
+
+// Bytes of every line of the input, with its newline
+#define BENCH_LINE 64
+
+typedef struct {
+	const char *name;
+	// Script, or the file it is on if file is set
+	const char *script;
+	int file;
+	// Feed the input through a pipe on standard input instead of giving its path, as in `head -c 10M file | east script`
+	int piped;
+	// More flags for east, on the same argument as the ones given to bench
+	const char *flags;
+	// Instructions of the script run for every byte of the input, 0 if that isn't known
+	double instructions;
+} bench_t;
+
+// Microbenchmarks loop once per byte of the input, the counts include the `]` of that loop
+static const bench_t benches[] = {
+	// Instruction classes
+	{"push",      "[0123456789,,,,,,,,,,>]", 0, 0, "",  22},
+	{"input",     "[.,>]",                   0, 0, "",  4},
+	{"math",      "[.1+2*3-4/,>]",           0, 0, "",  12},
+	{"reverse",   "[12!!!!!!!!,,>]",         0, 0, "",  14},
+	{"rotate",    "[123@@@@@@,,,>]",         0, 0, "",  14},
+	// `=` runs "a" every time, found on its cache
+	{"exec",      "[1&-a=,,,>]",             0, 0, "",  11},
+	{"call",      "%aa,^[$a>]",              0, 0, "",  5},
+	{"inputloop", "[>]",                     0, 0, "",  2},
+	// 5 items popped by the `{,}` loop, down to the NUL at the bottom
+	{"dataloop",  "1&-[.....{,}>]",          0, 0, "",  18},
+	// The whole input pushed at once, then multiplied and summed by `|` a segment at a time
+	{"segment",   "[.>]3|*|s,",              0, 0, "",  0},
+	// `|f` jumping from line to line
+	{"scan",      "[\\n|f,>]",               0, 0, "",  0},
+	// Programs from the examples
+	{"cat",       "examples/cat.east",       1, 0, "",  4},
+	// cat again, reading standard input from a pipe
+	{"cat-pipe",  "examples/cat.east",       1, 1, "",  4},
+	{"rev",       "examples/rev.east",       1, 0, "",  5},
+	{"rev-lines", "examples/rev.east",       1, 0, "L", 0},
+	{"square",    "examples/square.east",    1, 0, "L", 0}
+};
+
+static double Now() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Lines of lowercase letters, the same for every size
+static void Generate(const char *path, size_t size) {
+	FILE *fp = fopen(path, "wb");
+	if (!fp)
+		BENCH_ERR("Can't create the input");
+
+	char line[BENCH_LINE];
+	unsigned long seed = 1;
+
+	for (size_t done = 0; done < size; done += sizeof(line)) {
+		for (size_t i = 0; i < sizeof(line) - 1; i++) {
+			seed = seed * 1103515245 + 12345;
+			line[i] = 'a' + (seed >> 16) % 26;
+		}
+		line[sizeof(line) - 1] = '\n';
+
+		size_t length = (size - done < sizeof(line)) ? size - done : sizeof(line);
+		if (fwrite(line, 1, length, fp) != length)
+			BENCH_ERR("Can't write the input");
+	}
+
+	fclose(fp);
+}
+
+// Copy the input to the pipe as `cat` would, in a process of its own so the reading and writing overlap
+static pid_t Feed(const char *input, const int fds[2]) {
+	pid_t pid = fork();
+
+	if (pid < 0)
+		BENCH_ERR("fork failed");
+
+	if (pid == 0) {
+		// Only east reads, so the copy stops if it ends early
+		close(fds[0]);
+		int in = open(input, O_RDONLY);
+		if (in < 0)
+			_exit(1);
+
+		char buffer[65536];
+		ssize_t n;
+
+		while ((n = read(in, buffer, sizeof(buffer))) > 0)
+			for (ssize_t done = 0; done < n;) {
+				ssize_t w = write(fds[1], buffer + done, n - done);
+				if (w < 0)
+					_exit(1);
+				done += w;
+			}
+
+		_exit(n < 0);
+	}
+
+	return pid;
+}
+
+// Seconds taken by east to run the benchmark on the input, with its output thrown away
+static double Run(const char *east, const bench_t *B, const char *flags, const char *input) {
+	// -F has to go first, so flags like -L don't read it as a number
+	char arg[256];
+	snprintf(arg, sizeof(arg), "-%s%s%s", B->file ? "F" : "", flags, B->flags);
+
+	int fds[2];
+	if (B->piped && pipe(fds) != 0)
+		BENCH_ERR("pipe failed");
+
+	double start = Now();
+	pid_t feeder = B->piped ? Feed(input, fds) : 0;
+	pid_t pid = fork();
+
+	if (pid < 0)
+		BENCH_ERR("fork failed");
+
+	if (pid == 0) {
+		int null = open("/dev/null", O_WRONLY);
+		dup2(null, STDOUT_FILENO);
+
+		// Without a file east reads standard input
+		if (B->piped) {
+			dup2(fds[0], STDIN_FILENO);
+			close(fds[0]);
+			close(fds[1]);
+			input = NULL;
+		}
+
+		if (strcmp(arg, "-") == 0)
+			execl(east, east, B->script, input, (char*)NULL);
+		else
+			execl(east, east, arg, B->script, input, (char*)NULL);
+		_exit(127);
+	}
+
+	if (B->piped) {
+		close(fds[0]);
+		close(fds[1]);
+	}
+
+	int status, fed = 0;
+	waitpid(pid, &status, 0);
+	if (feeder)
+		waitpid(feeder, &fed, 0);
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || fed != 0) {
+		fprintf(stderr, "bench: %s failed\n", B->name);
+		return -1;
+	}
+
+	return Now() - start;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 3 || argc > 4) {
+		fprintf(stderr, "Usage: bench path/to/east size_in_MB [flags]\n");
+		return 1;
+	}
+
+	const char *east = argv[1];
+	size_t size = strtoul(argv[2], NULL, 10) * 1000000;
+	const char *flags = (argc == 4) ? argv[3] : "";
+
+	// Flags are given without the dash, as in J for -J
+	if (*flags == '-')
+		flags++;
+
+	if (size == 0)
+		BENCH_ERR("The size has to be at least 1 MB");
+
+	// Generating big inputs takes a while, they are kept for the next runs
+	const char *tmp = getenv("TMPDIR");
+	char input[4096];
+	snprintf(input, sizeof(input), "%s/east-bench-%zu.txt", tmp ? tmp : "/tmp", size);
+
+	struct stat st;
+	if (stat(input, &st) != 0 || (size_t)st.st_size != size) {
+		fprintf(stderr, "bench: generating %s\n", input);
+		Generate(input, size);
+	}
+
+	printf("name\tflags\tbytes\tseconds\tns_per_instruction\tMB_per_second\n");
+	int failed = 0;
+
+	for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+		const bench_t *B = &benches[i];
+		double best = -1;
+
+		for (int j = 0; j < BENCH_REPEAT; j++) {
+			double t = Run(east, B, flags, input);
+			if (t < 0)
+				break;
+			if (best < 0 || t < best)
+				best = t;
+		}
+
+		if (best < 0) {
+			failed = 1;
+			continue;
+		}
+
+		printf("%s\t%s%s\t%zu\t%.4f\t", B->name, flags, B->flags, size, best);
+		if (B->instructions)
+			printf("%.3f", best * 1e9 / (size * B->instructions));
+		else
+			printf("-");
+		printf("\t%.1f\n", size / 1e6 / best);
+		fflush(stdout);
+	}
+
+	return failed;
+}
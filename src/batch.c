@@ -0,0 +1,390 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// fork, pipe, poll and waitpid are POSIX
+#define _POSIX_C_SOURCE 200112L
+
+#include "batch.h"
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+
+#define BATCH_ERR(msg) do {fprintf(stderr,"East, fatal error: %s\n", msg);exit(1);} while (0)
+
+// How much is read from a worker at once, and how much a worker collects before sending it
+#define EAST_BATCH_READ 65536
+
+// Records are handed to the workers in chunks of at least this many bytes, and about 4 chunks per worker
+#define EAST_BATCH_CHUNK 65536
+
+// A file or a chunk of records, its output is kept until every job before it has been written
+typedef struct {
+	pid_t pid;
+	// Read end of the pipe with the output, -1 once it ended
+	int fd;
+	char *buffer;
+	size_t length;
+	size_t size;
+	int failed;
+	// Bytes of the input in the chunk, for records
+	size_t start;
+	size_t end;
+} job_t;
+
+// What every job runs, and on what
+typedef struct {
+	const east_options_t *options;
+	east_script_t *script;
+	east_mode_t mode;
+	// Either files, or records of input split on delim
+	char **files;
+	char *input;
+	char delim;
+	job_t *jobs;
+	size_t count;
+	// Of the worker, shared by every input it runs, with what it wrote so far (sent to fd in big pieces)
+	east_t *engine;
+	int fd;
+	char *out;
+	size_t out_length;
+	size_t out_size;
+} batch_t;
+
+// write(2) until everything is written
+static void BatchWriteAll(int fd, const char *string, size_t length) {
+	while (length) {
+		ssize_t written = write(fd, string, length);
+
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+
+		string += written;
+		length -= written;
+	}
+}
+
+// Output of the engine of a worker, collected and sent to the parent once there is enough of it
+static void BatchCollect(void *user, const char *string, size_t length) {
+	batch_t *B = user;
+
+	if (B->out_length + length > B->out_size) {
+		size_t size = B->out_size ? B->out_size : EAST_BATCH_READ;
+		while (B->out_length + length > size)
+			size *= 2;
+
+		char *tmp = realloc(B->out, size);
+		if (!tmp) {
+			fprintf(stderr, "East, fatal error: Out of memory\n");
+			_exit(1);
+		}
+
+		B->out = tmp;
+		B->out_size = size;
+	}
+
+	memcpy(B->out + B->out_length, string, length);
+	B->out_length += length;
+
+	if (B->out_length >= EAST_BATCH_READ) {
+		BatchWriteAll(B->fd, B->out, B->out_length);
+		B->out_length = 0;
+	}
+}
+
+// Run the script on a single input, the output ends with a newline even if it failed, returns if it did
+static int BatchExecute(batch_t *B, const char *input, size_t input_length) {
+	east_error_t error;
+	int status = East_Run(B->engine, B->script, B->mode, input, input_length, &error);
+
+	if (status != EAST_OK)
+		East_PrintError(&error, stderr);
+
+	// Same as a normal run
+	BatchCollect(B, "\n", 1);
+	return status != EAST_OK;
+}
+
+// End a worker, sending what it wrote first
+// _exit skips the handlers of the parent (as the one printing -s), which only the parent has to run
+static void BatchExit(batch_t *B, int status) {
+	if (B->engine)
+		East_Delete(B->engine);
+
+	BatchWriteAll(B->fd, B->out, B->out_length);
+	_exit(status);
+}
+
+// Worker for the job i, never returns
+static void BatchWorker(batch_t *B, size_t i, int fd) {
+	// Its own engine, writing to the pipe of the job
+	east_options_t options = *B->options;
+	options.write = BatchCollect;
+	options.user = B;
+	options.line_flush = 0;
+
+	B->fd = fd;
+	B->engine = East_Create(&options);
+
+	if (!B->engine) {
+		fprintf(stderr, "East, fatal error: Out of memory\n");
+		BatchExit(B, 1);
+	}
+
+	if (B->files) {
+		FILE *fp = fopen(B->files[i], "r");
+		if (fp == NULL) {
+			fprintf(stderr, "East: No such file '%s'\n", B->files[i]);
+			BatchExit(B, 1);
+		}
+
+		size_t input_length;
+		char *input = MapFile(&input_length, fp);
+		fclose(fp);
+
+		BatchExit(B, BatchExecute(B, input, input_length));
+	}
+
+	// Every record of the chunk, on its own, an error only stops its record
+	char *record = B->input + B->jobs[i].start;
+	char *end = B->input + B->jobs[i].end;
+	int failed = 0;
+
+	while (1) {
+		char *next = memchr(record, B->delim, end - record);
+		if (!next)
+			next = end;
+
+		if (BatchExecute(B, record, next - record)) {
+			fprintf(stderr, "East: Failed on the record from byte %zu to %zu\n", (size_t)(record - B->input), (size_t)(next - B->input));
+			failed = 1;
+		}
+
+		if (next == end)
+			break;
+		record = next + 1;
+	}
+
+	BatchExit(B, failed);
+}
+
+// Write part of the output of a job where the options say
+static void BatchOutput(batch_t *B, const char *string, size_t length) {
+	if (B->options->write) {
+		if (length)
+			B->options->write(B->options->user, string, length);
+	} else {
+		BatchWriteAll(B->options->fd, string, length);
+	}
+}
+
+static void BatchStart(batch_t *B, size_t i) {
+	job_t *J = &B->jobs[i];
+	int fds[2];
+
+	if (pipe(fds) != 0)
+		BATCH_ERR("Can't create a pipe for a worker");
+
+	// Nothing buffered by stdio should be written twice
+	fflush(NULL);
+
+	J->pid = fork();
+	if (J->pid < 0)
+		BATCH_ERR("Can't start a worker");
+
+	if (J->pid == 0) {
+		close(fds[0]);
+		BatchWorker(B, i, fds[1]);
+	}
+
+	close(fds[1]);
+	J->fd = fds[0];
+}
+
+// Read what the worker of job i wrote, collecting it once it ends
+static void BatchRead(batch_t *B, size_t i, size_t *running) {
+	job_t *J = &B->jobs[i];
+
+	if (J->length + EAST_BATCH_READ > J->size) {
+		size_t size = J->size ? J->size*2 : EAST_BATCH_READ;
+		while (J->length + EAST_BATCH_READ > size)
+			size *= 2;
+
+		char *tmp = realloc(J->buffer, size);
+		if (!tmp)
+			BATCH_ERR("Out of memory");
+
+		J->buffer = tmp;
+		J->size = size;
+	}
+
+	ssize_t got = read(J->fd, J->buffer + J->length, EAST_BATCH_READ);
+
+	if (got < 0 && errno == EINTR)
+		return;
+
+	if (got > 0) {
+		J->length += got;
+		return;
+	}
+
+	// Ended (or broke), the exit status tells if it went well
+	int status;
+	close(J->fd);
+	J->fd = -1;
+	(*running)--;
+
+	while (waitpid(J->pid, &status, 0) < 0 && errno == EINTR);
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		J->failed = 1;
+		// Workers of records report each record that failed, only a crash is left to report here
+		if (B->files)
+			fprintf(stderr, "East: Failed on '%s'\n", B->files[i]);
+		else if (!WIFEXITED(status) || WEXITSTATUS(status) != 1)
+			fprintf(stderr, "East: Failed on the records from byte %zu to %zu\n", J->start, J->end);
+	}
+}
+
+// Run every job with up to workers processes at once, writing the outputs in order
+static size_t BatchRun(batch_t *B, size_t workers) {
+	if (workers == 0) {
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		workers = (cores > 0) ? (size_t)cores : 1;
+	}
+
+	struct pollfd *polled = malloc(sizeof(struct pollfd)*workers);
+	size_t *polled_job = malloc(sizeof(size_t)*workers);
+
+	if (!polled || !polled_job)
+		BATCH_ERR("Out of memory");
+
+	size_t next_start = 0;
+	size_t next_write = 0;
+	size_t running = 0;
+	size_t failed = 0;
+
+	while (next_write < B->count) {
+		while (running < workers && next_start < B->count) {
+			BatchStart(B, next_start);
+			next_start++;
+			running++;
+		}
+
+		// Wait for any running worker to write or end
+		size_t polled_length = 0;
+		for (size_t i = next_write; i < next_start; i++) {
+			if (B->jobs[i].fd < 0)
+				continue;
+
+			polled[polled_length].fd = B->jobs[i].fd;
+			polled[polled_length].events = POLLIN;
+			polled_job[polled_length] = i;
+			polled_length++;
+		}
+
+		if (polled_length && poll(polled, polled_length, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			BATCH_ERR("Can't wait for the workers");
+		}
+
+		for (size_t i = 0; i < polled_length; i++)
+			if (polled[i].revents)
+				BatchRead(B, polled_job[i], &running);
+
+		// The first job not written yet goes out as it arrives, the rest wait for it
+		while (next_write < next_start) {
+			job_t *first = &B->jobs[next_write];
+
+			BatchOutput(B, first->buffer, first->length);
+			first->length = 0;
+
+			if (first->fd >= 0)
+				break;
+
+			failed += first->failed;
+			free(first->buffer);
+			next_write++;
+		}
+	}
+
+	free(polled);
+	free(polled_job);
+	return failed;
+}
+
+size_t Batch_Files(const east_options_t *options, east_script_t *script, east_mode_t mode, char **files, size_t count, size_t workers) {
+	batch_t B = { .options = options, .script = script, .mode = mode, .files = files, .count = count };
+
+	B.jobs = calloc(count, sizeof(job_t));
+	if (!B.jobs)
+		BATCH_ERR("Out of memory");
+
+	size_t failed = BatchRun(&B, workers);
+	free(B.jobs);
+	return failed;
+}
+
+size_t Batch_Records(const east_options_t *options, east_script_t *script, east_mode_t mode, char *input, size_t input_length, char delim, size_t workers) {
+	batch_t B = { .options = options, .script = script, .mode = mode, .input = input, .delim = delim };
+
+	if (workers == 0) {
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		workers = (cores > 0) ? (size_t)cores : 1;
+	}
+
+	size_t chunk = input_length / (workers*4);
+	if (chunk < EAST_BATCH_CHUNK)
+		chunk = EAST_BATCH_CHUNK;
+
+	// Never more chunks than this, each one has at least a byte
+	size_t size = input_length / chunk + 1;
+	B.jobs = calloc(size, sizeof(job_t));
+	if (!B.jobs)
+		BATCH_ERR("Out of memory");
+
+	// Cut after the first delimiter past every chunk sized step, so records stay whole
+	size_t start = 0;
+	do {
+		size_t end = input_length;
+
+		if (input_length - start > chunk) {
+			char *cut = memchr(input + start + chunk, delim, input_length - start - chunk);
+			if (cut)
+				end = cut - input;
+		}
+
+		B.jobs[B.count].start = start;
+		B.jobs[B.count].end = end;
+		B.count++;
+		start = end + 1;
+	} while (start <= input_length && B.count < size);
+
+	size_t failed = BatchRun(&B, workers);
+	free(B.jobs);
+	return failed;
+}
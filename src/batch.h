@@ -0,0 +1,34 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef EAST_BATCH_H
+#define EAST_BATCH_H
+
+#include "libeast.h"
+
+// Run the compiled script on every file (as the input) with up to workers processes at once, 0 meaning one per core
+// Each file gets a process of its own, forked after compiling, with an engine made from options, so an error only stops its file
+// The outputs are written where options says in the order of the files, each ending with a newline, returns how many failed
+size_t Batch_Files(const east_options_t *options, east_script_t *script, east_mode_t mode, char **files, size_t count, size_t workers);
+
+// Same, but on every record of the input (split on delim)
+// Records are handed to the processes in chunks, an error only stops its record (which still ends its line)
+// Returns how many chunks had a record that failed
+size_t Batch_Records(const east_options_t *options, east_script_t *script, east_mode_t mode, char *input, size_t input_length, char delim, size_t workers);
+
+#endif // EAST_BATCH_H
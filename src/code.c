@@ -0,0 +1,637 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "code.h"
+#include "simd.h"
+
+#define NO_ENTRY ((pc_t)-1)
+
+// Highest number of items CodeVerify keeps track of
+#define CODE_DEPTH_MAX 64
+
+// Characters after escaping them
+static const char escaped[128] = {
+	'0','1','2','3','4','5','6','7','8',
+	'9','0','1','2','3','4','5','6','7',
+	'8','9','0','1','2','3','4','5','6',
+	'7','8','9','0','1',' ','!','"','#',
+	'$','%','&','\'','(',')','*','+',
+	',','-','.','/',0,1,2,3,4,5,6,7,8,9,
+	':',';','<','=','>','?','@','A','B',
+	'C','D','E','F','G','H','I','J','K',
+	'L','M','N','O','P','Q','R','S','T',
+	'U','V','W','X','Y','Z','[','\\',
+	']','^','_','`','\a','\b','c','d',
+	'\027','\f','g','h','i','j','k','l',
+	'm','\n','o','p','q','\r','s','\t',
+	'u','\v','w','x','y','z','{','|',
+	'}','~','H'
+};
+
+// Messages for OP_ERROR
+const char *Code_Errors[] = {
+	[CODE_ERR_ESCAPE_EOF] = "Expected a character to escape, got EOF",
+	[CODE_ERR_CALL_EOF]   = "Tried to call EOF as an user defined instruction",
+	[CODE_ERR_FUNC_EOF]   = "Expected '^' on function definition, got EOF",
+	[CODE_ERR_SKIP_EOF]   = "No instruction to skip to"
+};
+
+unsigned char Code_Checked(unsigned char op) {
+	switch (op) {
+		case OP_SAFEPOP:      return OP_POPITEM;
+		case OP_SAFEDUP:      return OP_DUPITEM;
+		case OP_SAFEPRINT:    return OP_PRINTCHAR;
+		case OP_SAFEADD:      return OP_ADD;
+		case OP_SAFESUB:      return OP_SUB;
+		case OP_SAFEMULT:     return OP_MULT;
+		case OP_SAFEDIV:      return OP_DIV;
+		case OP_SAFEADDCONST: return OP_ADDCONST;
+		default:              return op;
+	}
+}
+
+// State used only while compiling
+typedef struct {
+	const char *string;
+	size_t length;
+	code_t code;
+	// Instruction that behaves exactly like starting execution from the given position of the string
+	pc_t *entry;
+	// Index of the OP_END that closes the main instruction stream
+	pc_t end;
+	// Set when some `[ ]` or `{ }` can't be resolved on compile time
+	int dynamic;
+} compiler_t;
+
+// Append an instruction, doubling the size of the code if necessary
+static pc_t CodeEmit(compiler_t *C, unsigned char op, char arg, pc_t pos) {
+	if (C->code.length+1 > C->code.size) {
+		C->code.size *= 2;
+
+		op_t *tmp = realloc(C->code.ops, sizeof(op_t)*C->code.size);
+
+		if (!tmp)
+			CODE_ERR("Out of memory");
+
+		C->code.ops = tmp;
+	}
+
+	C->code.ops[C->code.length] = (op_t){ .op = op, .arg = arg, .pos = pos, .jump = 0 };
+	return C->code.length++;
+}
+
+// Compile the instruction starting at r (if any), return where the next one starts
+static size_t CodeUnit(compiler_t *C, size_t r) {
+	const char *s = C->string;
+	size_t cur;
+	pc_t cur_op;
+
+	switch (s[r]) {
+		// Used for readability
+		case ' ':
+		case '\n':
+		case '\t':
+			return r+1;
+		// Comments end on the newline, which also gets skipped
+		case '#':
+			while (r < C->length && s[r] != '\n')
+				r++;
+			return (r < C->length) ? r+1 : r;
+		case '\\':
+			if (r+1 >= C->length) {
+				CodeEmit(C, OP_ERROR, CODE_ERR_ESCAPE_EOF, r);
+				return r+1;
+			}
+			CodeEmit(C, OP_PUSH, ((unsigned char)s[r+1] < 128) ? escaped[(size_t)s[r+1]] : s[r+1], r);
+			return r+2;
+		case '$':
+			if (r+1 >= C->length) {
+				CodeEmit(C, OP_ERROR, CODE_ERR_CALL_EOF, r);
+				return r+1;
+			}
+			CodeEmit(C, OP_FUNCEXEC, s[r+1], r);
+			return r+2;
+		case '|':
+			// Only followed by an operation, a `|` is a literal like any other character
+			if (r+1 < C->length && s[r+1] != '\0' && strchr(SIMD_OPS, s[r+1])) {
+				simd_op_t op = (simd_op_t)(strchr(SIMD_OPS, s[r+1]) - SIMD_OPS);
+				CodeEmit(C, (op < SIMD_SUM) ? OP_SEGMAP : (op < SIMD_FIND) ? OP_SEGREDUCE : OP_SCAN, (char)op, r);
+				return r+2;
+			}
+			CodeEmit(C, OP_PUSH, s[r], r);
+			return r+1;
+		case '%':
+			for (cur = r+1; cur < C->length && s[cur] != '^'; cur++);
+
+			if (cur >= C->length) {
+				CodeEmit(C, OP_ERROR, CODE_ERR_FUNC_EOF, r);
+				return C->length;
+			}
+
+			cur_op = CodeEmit(C, OP_FUNCDEC, 0, r);
+			C->code.ops[cur_op].jump = cur;
+			return cur+1;
+		case '>': CodeEmit(C, OP_NEXTCHAR, 0, r);    break;
+		case '<': CodeEmit(C, OP_PREVCHAR, 0, r);    break;
+		case '.': CodeEmit(C, OP_PUSHITEM, 0, r);    break;
+		case ',': CodeEmit(C, OP_POPITEM, 0, r);     break;
+		case '&': CodeEmit(C, OP_DUPITEM, 0, r);     break;
+		case ';': CodeEmit(C, OP_PRINTCHAR, 0, r);   break;
+		case ':': CodeEmit(C, OP_PRINTNUMBER, 0, r); break;
+		case '+': CodeEmit(C, OP_ADD, 0, r);         break;
+		case '-': CodeEmit(C, OP_SUB, 0, r);         break;
+		case '*': CodeEmit(C, OP_MULT, 0, r);        break;
+		case '/': CodeEmit(C, OP_DIV, 0, r);         break;
+		case '!': CodeEmit(C, OP_REVERSE, 0, r);     break;
+		case '@': CodeEmit(C, OP_ROTATE, 0, r);      break;
+		case '=': CodeEmit(C, OP_EXECDATA, 0, r);    break;
+		case '[': CodeEmit(C, OP_SETINPUTWP, 0, r);  break;
+		case ']': CodeEmit(C, OP_USEINPUTWP, 0, r);  break;
+		case '{': CodeEmit(C, OP_SETDATAWP, 0, r);   break;
+		case '}': CodeEmit(C, OP_USEDATAWP, 0, r);   break;
+		case '?': CodeEmit(C, OP_IFNOTEQUAL, 0, r);  break;
+		case '_': CodeEmit(C, OP_PUSH, ' ', r);      break;
+		default:  CodeEmit(C, OP_PUSH, s[r], r);     break;
+	}
+
+	return r+1;
+}
+
+static int IsWaypoint(unsigned char op) {
+	return op == OP_SETINPUTWP || op == OP_USEINPUTWP || op == OP_SETDATAWP || op == OP_USEDATAWP;
+}
+
+// Get an instruction that behaves like starting execution from position q of the string
+// Positions in the middle of an instruction (like the 'n' in "\n", which `?` can land on) get their own instructions, which join the rest once they line up again
+static pc_t CodeResolve(compiler_t *C, size_t q) {
+	if (q >= C->length)
+		return C->end;
+
+	if (C->entry[q] != NO_ENTRY)
+		return C->entry[q];
+
+	pc_t start = C->code.length;
+	size_t from = q;
+
+	while (q < C->length && C->entry[q] == NO_ENTRY) {
+		C->entry[q] = C->code.length;
+		q = CodeUnit(C, q);
+	}
+
+	pc_t target = (q < C->length) ? C->entry[q] : C->end;
+	CodeEmit(C, OP_JUMP, 0, q);
+	C->code.ops[C->code.length-1].jump = target;
+
+	// Waypoints skipped or set by this path break the pairing of brackets
+	for (pc_t k = start; k < C->code.length; k++)
+		if (IsWaypoint(C->code.ops[k].op))
+			C->dynamic = 1;
+
+	for (; from < q; from++) {
+		pc_t k = C->entry[from];
+		if (k < C->end && C->code.ops[k].pos == from && IsWaypoint(C->code.ops[k].op))
+			C->dynamic = 1;
+	}
+
+	return start;
+}
+
+// Find where every `?` from the instruction k onwards lands when it skips
+static void CodeSkips(compiler_t *C, pc_t k) {
+	// The length grows while resolving, so every new `?` gets handled too
+	for (; k < C->code.length; k++) {
+		if (C->code.ops[k].op != OP_IFNOTEQUAL)
+			continue;
+
+		size_t p = C->code.ops[k].pos;
+		pc_t target;
+
+		if (p+1 >= C->length) {
+			target = CodeEmit(C, OP_ERROR, CODE_ERR_SKIP_EOF, p);
+		} else {
+			// Skipping a waypoint would make the next `]` or `}` use an older one
+			if (C->string[p+1] == '[' || C->string[p+1] == '{')
+				C->dynamic = 1;
+
+			target = CodeResolve(C, p+2);
+		}
+
+		C->code.ops[k].jump = target;
+	}
+}
+
+// Pair every `[` with its `]` and every `{` with its `}` if that doesn't change what the waypoint stacks would do
+// That is only true when the brackets are balanced and never nested inside the same kind
+static void CodePairLoops(compiler_t *C) {
+	op_t *ops = C->code.ops;
+	pc_t input_open = NO_ENTRY;
+	pc_t data_open = NO_ENTRY;
+	// Kind of every open bracket, as they must close in order
+	char *kinds = malloc(C->end+1);
+	size_t depth = 0;
+
+	if (!kinds)
+		CODE_ERR("Out of memory");
+
+	for (pc_t k = 0; k < C->end && !C->dynamic; k++) {
+		switch (ops[k].op) {
+			case OP_SETINPUTWP:
+				if (input_open != NO_ENTRY)
+					C->dynamic = 1;
+				input_open = k;
+				kinds[depth++] = '[';
+				break;
+			case OP_SETDATAWP:
+				if (data_open != NO_ENTRY)
+					C->dynamic = 1;
+				data_open = k;
+				kinds[depth++] = '{';
+				break;
+			case OP_USEINPUTWP:
+				if (depth == 0 || kinds[depth-1] != '[')
+					C->dynamic = 1;
+				depth--;
+				ops[k].jump = input_open;
+				input_open = NO_ENTRY;
+				break;
+			case OP_USEDATAWP:
+				if (depth == 0 || kinds[depth-1] != '{')
+					C->dynamic = 1;
+				depth--;
+				ops[k].jump = data_open;
+				data_open = NO_ENTRY;
+				break;
+		}
+	}
+
+	if (depth != 0)
+		C->dynamic = 1;
+
+	free(kinds);
+
+	if (C->dynamic)
+		return;
+
+	// The body of the loop starts right after the (now useless) opening bracket
+	for (pc_t k = 0; k < C->end; k++) {
+		switch (ops[k].op) {
+			case OP_SETINPUTWP:
+			case OP_SETDATAWP:
+				ops[k].op = OP_NOP;
+				break;
+			case OP_USEINPUTWP:
+				ops[k].op = OP_INPUTLOOP;
+				break;
+			case OP_USEDATAWP:
+				ops[k].op = OP_DATALOOP;
+				break;
+		}
+	}
+}
+
+static int HasJump(unsigned char op) {
+	return op == OP_INPUTLOOP || op == OP_DATALOOP || op == OP_IFNOTEQUAL || op == OP_JUMP;
+}
+
+// Remove every OP_NOP, fixing the jumps that go through them
+static void CodeCompact(compiler_t *C) {
+	op_t *ops = C->code.ops;
+	// Index every instruction will have once compacted, a NOP takes the one of the instruction after it
+	pc_t *moved = malloc(sizeof(pc_t)*(C->code.length+1));
+
+	if (!moved)
+		CODE_ERR("Out of memory");
+
+	pc_t length = 0;
+	for (pc_t k = 0; k < C->code.length; k++) {
+		moved[k] = length;
+		if (ops[k].op != OP_NOP)
+			length++;
+	}
+	moved[C->code.length] = length;
+
+	for (pc_t k = 0; k < C->code.length; k++) {
+		if (HasJump(ops[k].op))
+			ops[k].jump = moved[ops[k].jump];
+		if (ops[k].op != OP_NOP)
+			ops[moved[k]] = ops[k];
+	}
+
+	C->code.restart = moved[C->code.restart];
+	C->end = moved[C->end];
+	C->code.length = length;
+
+	free(moved);
+}
+
+// Check if the instructions from k onwards are the given ones, and that only the first one can be jumped to
+static int CodeMatch(compiler_t *C, const char *targets, pc_t k, const unsigned char *pattern, size_t n) {
+	if (k+n > C->code.length)
+		return 0;
+
+	for (size_t i = 0; i < n; i++) {
+		if (C->code.ops[k+i].op != pattern[i])
+			return 0;
+		if (i > 0 && targets[k+i])
+			return 0;
+	}
+
+	return 1;
+}
+
+// Replace the n instructions from k with a single op, the rest become OP_NOP
+static void CodeFuse(compiler_t *C, pc_t k, size_t n, unsigned char op) {
+	C->code.ops[k].op = op;
+
+	for (size_t i = 1; i < n; i++)
+		C->code.ops[k+i].op = OP_NOP;
+}
+
+// Replace common idioms with instructions that do the same job in one step, returns if anything changed
+static int CodePeephole(compiler_t *C) {
+	static const unsigned char push_input[] = { OP_PUSHITEM, OP_NEXTCHAR, OP_INPUTLOOP };
+	static const unsigned char cat_input[]  = { OP_PUSHITEM, OP_PRINTCHAR, OP_NEXTCHAR, OP_INPUTLOOP };
+	static const unsigned char print_data[] = { OP_PRINTCHAR, OP_DATALOOP };
+	static const unsigned char rotate_back[] = { OP_REVERSE, OP_ROTATE, OP_REVERSE };
+	static const unsigned char add_const[]  = { OP_PUSH, OP_ADD };
+
+	op_t *ops = C->code.ops;
+	int changed = 0;
+	// Instructions something jumps to, a pattern can only be entered from its start
+	char *targets = calloc(C->code.length+1, 1);
+
+	if (!targets)
+		CODE_ERR("Out of memory");
+
+	for (pc_t k = 0; k < C->code.length; k++)
+		if (HasJump(ops[k].op))
+			targets[ops[k].jump] = 1;
+	targets[C->code.restart] = 1;
+
+	for (pc_t k = 0; k < C->code.length; k++) {
+		// Loops have to jump back to the start of the pattern
+		if (CodeMatch(C, targets, k, push_input, 3) && ops[k+2].jump == k) {
+			CodeFuse(C, k, 3, OP_PUSHINPUT);
+		} else if (CodeMatch(C, targets, k, cat_input, 4) && ops[k+3].jump == k) {
+			CodeFuse(C, k, 4, OP_CATINPUT);
+		} else if (CodeMatch(C, targets, k, print_data, 2) && ops[k+1].jump == k) {
+			CodeFuse(C, k, 2, OP_PRINTDATA);
+		} else if (CodeMatch(C, targets, k, rotate_back, 3)) {
+			CodeFuse(C, k, 3, OP_ROTATEBACK);
+		} else if (CodeMatch(C, targets, k, add_const, 2)) {
+			// Only the addition can fail, so errors point to it
+			ops[k].pos = ops[k+1].pos;
+			CodeFuse(C, k, 2, OP_ADDCONST);
+		} else {
+			continue;
+		}
+
+		changed = 1;
+	}
+
+	free(targets);
+	return changed;
+}
+
+// Items an instruction fails without
+static size_t CodeNeeds(const op_t *op) {
+	switch (op->op) {
+		case OP_POPITEM:
+		case OP_DUPITEM:
+		case OP_PRINTCHAR:
+		case OP_PRINTNUMBER:
+		case OP_PRINTDATA:
+		case OP_ADDCONST:
+		case OP_SEGMAP:
+			return 1;
+		case OP_SCAN:
+			return op->arg == SIMD_FIND;
+		case OP_ADD:
+		case OP_SUB:
+		case OP_MULT:
+		case OP_DIV:
+		case OP_IFNOTEQUAL:
+			return 2;
+		default:
+			return 0;
+	}
+}
+
+// Least items the data has after an instruction that didn't fail, given the least it had before
+static size_t CodeEffect(const op_t *op, size_t depth) {
+	size_t needs = CodeNeeds(op);
+
+	// If it didn't fail, it had what it needs
+	if (depth < needs)
+		depth = needs;
+
+	switch (op->op) {
+		case OP_PUSHITEM:
+		case OP_PUSH:
+		case OP_DUPITEM:
+		case OP_PUSHINPUT:
+			depth++;
+			break;
+		case OP_POPITEM:
+		case OP_PRINTCHAR:
+		case OP_PRINTNUMBER:
+		case OP_ADD:
+		case OP_SUB:
+		case OP_MULT:
+		case OP_DIV:
+		case OP_IFNOTEQUAL:
+		case OP_SEGMAP:
+			depth--;
+			break;
+		case OP_PRINTDATA:
+			// Prints until a NUL, which may be below everything that is known
+			depth = 0;
+			break;
+		case OP_SEGREDUCE:
+			depth = 1;
+			break;
+		case OP_SCAN:
+			if (op->arg != SIMD_FIND)
+				depth = 1;
+			break;
+		case OP_EXECDATA:
+		case OP_FUNCEXEC:
+			// The code they run can leave anything
+			depth = 0;
+			break;
+	}
+
+	// Enough to prove anything a script does on a row, and it keeps the number of passes low
+	return (depth < CODE_DEPTH_MAX) ? depth : CODE_DEPTH_MAX;
+}
+
+// Lower what is known of k, looking at it again if that changed anything
+static void CodeReach(size_t *depths, char *queued, pc_t *queue, size_t *length, pc_t k, size_t depth) {
+	if (depth >= depths[k])
+		return;
+
+	depths[k] = depth;
+	if (!queued[k]) {
+		queued[k] = 1;
+		queue[(*length)++] = k;
+	}
+}
+
+// Find the least items the data has before each instruction on every path to it, then make the ones that can't fail there skip their checks
+// Nothing is known after `=` or `$`, or on the instructions `]` and `}` can go to without being paired
+static void CodeVerify(compiler_t *C) {
+	op_t *ops = C->code.ops;
+	size_t *depths = malloc(sizeof(size_t)*C->code.length);
+	char *queued = calloc(C->code.length, 1);
+	pc_t *queue = malloc(sizeof(pc_t)*C->code.length);
+	size_t length = 0;
+
+	if (!depths || !queued || !queue) {
+		free(depths);
+		free(queued);
+		free(queue);
+		CODE_ERR("Out of memory");
+	}
+
+	for (pc_t k = 0; k < C->code.length; k++)
+		depths[k] = (size_t)-1;
+
+	CodeReach(depths, queued, queue, &length, 0, 0);
+	CodeReach(depths, queued, queue, &length, C->code.restart, 0);
+	for (pc_t k = 0; k < C->code.length; k++)
+		if (ops[k].op == OP_SETINPUTWP || ops[k].op == OP_SETDATAWP)
+			CodeReach(depths, queued, queue, &length, k, 0);
+
+	while (length) {
+		pc_t k = queue[--length];
+		queued[k] = 0;
+
+		size_t depth = CodeEffect(&ops[k], depths[k]);
+
+		if (ops[k].op == OP_END || ops[k].op == OP_ERROR)
+			continue;
+		if (HasJump(ops[k].op))
+			CodeReach(depths, queued, queue, &length, ops[k].jump, depth);
+		if (ops[k].op != OP_JUMP)
+			CodeReach(depths, queued, queue, &length, k+1, depth);
+	}
+
+	for (pc_t k = 0; k < C->code.length; k++) {
+		// Unreachable instructions keep their checks, they never run anyway
+		if (depths[k] == (size_t)-1 || depths[k] < CodeNeeds(&ops[k]))
+			continue;
+
+		switch (ops[k].op) {
+			case OP_POPITEM:   ops[k].op = OP_SAFEPOP;      break;
+			case OP_DUPITEM:   ops[k].op = OP_SAFEDUP;      break;
+			case OP_PRINTCHAR: ops[k].op = OP_SAFEPRINT;    break;
+			case OP_ADD:       ops[k].op = OP_SAFEADD;      break;
+			case OP_SUB:       ops[k].op = OP_SAFESUB;      break;
+			case OP_MULT:      ops[k].op = OP_SAFEMULT;     break;
+			case OP_DIV:       ops[k].op = OP_SAFEDIV;      break;
+			case OP_ADDCONST:  ops[k].op = OP_SAFEADDCONST; break;
+		}
+	}
+
+	free(depths);
+	free(queued);
+	free(queue);
+}
+
+// Compile everything C was set up with
+static void CodeBuild(compiler_t *C, int optimize) {
+	C->code.ops = malloc(sizeof(op_t)*C->code.size);
+	C->entry = malloc(sizeof(pc_t)*(C->length+1));
+
+	if (!C->code.ops || !C->entry)
+		CODE_ERR("Out of memory");
+
+	for (size_t i = 0; i <= C->length; i++)
+		C->entry[i] = NO_ENTRY;
+
+	// Main instruction stream
+	size_t r = 0;
+	while (r < C->length) {
+		C->entry[r] = C->code.length;
+		r = CodeUnit(C, r);
+	}
+
+	C->end = CodeEmit(C, OP_END, 0, C->length);
+	C->entry[C->length] = C->end;
+	C->code.restart = C->end;
+
+	// Paths only reachable by skipping with `?` go after the end
+	CodeSkips(C, 0);
+	CodePairLoops(C);
+
+	// An empty waypoint stack sends execution to the second character, like setting pc to 0 did on older versions
+	if (C->dynamic) {
+		pc_t k = C->code.length;
+		C->code.restart = CodeResolve(C, 1);
+		CodeSkips(C, k);
+	} else {
+		CodeCompact(C);
+	}
+
+	if (optimize && CodePeephole(C))
+		CodeCompact(C);
+
+	if (optimize)
+		CodeVerify(C);
+}
+
+// Turn a script into a compiled code, which doesn't have whitespace or comments and knows where every loop goes
+code_t Code_Compile(const char *string, size_t length, int optimize) {
+	compiler_t C;
+
+	C.string = string;
+	C.length = length;
+	C.dynamic = 0;
+	C.code.length = 0;
+	C.code.size = 16;
+	C.code.profile = NULL;
+	C.code.ops = NULL;
+	C.entry = NULL;
+
+	// Running out of memory frees what was compiled so far, for callers that recover from it
+	jmp_buf jump;
+	jmp_buf *outer = Error_Jump;
+
+	if (outer) {
+		Error_Jump = &jump;
+
+		if (setjmp(jump)) {
+			Error_Jump = outer;
+			free(C.code.ops);
+			free(C.entry);
+			longjmp(*outer, 1);
+		}
+	}
+
+	CodeBuild(&C, optimize);
+
+	Error_Jump = outer;
+	free(C.entry);
+	return C.code;
+}
+
+// Destroy a compiled code
+void Code_Delete(code_t *C) {
+	free(C->ops);
+	C->length = 0;
+}
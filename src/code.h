@@ -0,0 +1,120 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef EAST_CODE_H
+#define EAST_CODE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+
+#define CODE_ERR(msg) Error_Raise(msg, 0, 0)
+
+// Define the type used by the program counter and by the waypoints
+typedef size_t pc_t;
+
+// Opcodes of the compiled script, whitespace and comments don't get one
+typedef enum {
+	OP_NEXTCHAR,    // >
+	OP_PREVCHAR,    // <
+	OP_PUSHITEM,    // .
+	OP_POPITEM,     // ,
+	OP_DUPITEM,     // &
+	OP_PRINTCHAR,   // ;
+	OP_PRINTNUMBER, // :
+	OP_ADD,         // +
+	OP_SUB,         // -
+	OP_MULT,        // *
+	OP_DIV,         // /
+	OP_REVERSE,     // !
+	OP_ROTATE,      // @
+	OP_EXECDATA,    // =
+	OP_PUSH,        // Literals, '_' and escaped characters, the value is on arg
+	OP_SETINPUTWP,  // [ when it can't be resolved on compile time
+	OP_USEINPUTWP,  // ] when it can't be resolved on compile time
+	OP_SETDATAWP,   // { when it can't be resolved on compile time
+	OP_USEDATAWP,   // } when it can't be resolved on compile time
+	OP_INPUTLOOP,   // ] jumping straight to the body of its [
+	OP_DATALOOP,    // } jumping straight to the body of its {
+	OP_IFNOTEQUAL,  // ?, jump holds where the skip lands
+	OP_FUNCDEC,     // %, jump holds the position of the '^' on the source
+	OP_FUNCEXEC,    // $, the name is on arg
+	OP_JUMP,        // Used to join the paths created by ? with the rest of the code
+	OP_ERROR,       // Instructions that fail when reached, arg indexes Code_Errors
+	OP_PUSHINPUT,   // [.>], push the rest of the input at once
+	OP_CATINPUT,    // [.;>], print the rest of the input at once
+	OP_PRINTDATA,   // {;}, print until a NUL
+	OP_ROTATEBACK,  // !@!, rotate the other way
+	OP_ADDCONST,    // A literal and +, the value is on arg
+	OP_SEGMAP,      // |+ |- |* |/, the simd_op_t is on arg
+	OP_SEGREDUCE,   // |s |< |> |c, the simd_op_t is on arg
+	OP_SCAN,        // |f |a, the simd_op_t is on arg
+	OP_SAFEPOP,     // , when the data is known to have enough items, so it doesn't check
+	OP_SAFEDUP,     // & without checking
+	OP_SAFEPRINT,   // ; without checking
+	OP_SAFEADD,     // + without checking
+	OP_SAFESUB,     // - without checking
+	OP_SAFEMULT,    // * without checking
+	OP_SAFEDIV,     // / without checking
+	OP_SAFEADDCONST, // Fused literal and + without checking
+	OP_NOP,         // Only exists while compiling
+	OP_END,
+	OP_COUNT
+} opcode_t;
+
+// Errors that are found while compiling but only reported when reached
+enum {
+	CODE_ERR_ESCAPE_EOF,
+	CODE_ERR_CALL_EOF,
+	CODE_ERR_FUNC_EOF,
+	CODE_ERR_SKIP_EOF
+};
+
+extern const char *Code_Errors[];
+
+// Individual compiled instruction
+typedef struct {
+	unsigned char op;
+	char arg;
+	// Position of the instruction on the source string, for error messages
+	pc_t pos;
+	pc_t jump;
+} op_t;
+
+struct prof_code_t;
+
+// Compiled script, always terminated by OP_END
+typedef struct {
+	op_t *ops;
+	size_t length;
+	size_t size;
+	// Where `]` and `}` go when their waypoint stack is empty
+	pc_t restart;
+	// What the profiler counted on it, owned by the profiler (NULL until it runs with -P)
+	struct prof_code_t *profile;
+} code_t;
+
+// The instruction that checks the data for an unchecked one, the same one for the rest
+unsigned char Code_Checked(unsigned char op);
+
+code_t Code_Compile(const char *string, size_t length, int optimize);
+void Code_Delete(code_t *C);
+
+#endif // EAST_CODE_H
@@ -23,9 +23,33 @@ data_t Data_Create(dmode_t mode) {
 	data_t tmp;
 
 	tmp.mode = mode;
+	tmp.head = 0;
 	tmp.length = 0;
-	tmp.size = 10;
-	tmp.items = calloc(sizeof(ditem_t), tmp.size);
+	tmp.size = 16;
+	tmp.reversed = 0;
+
+	// Only the items themselves are stored, without padding them to the biggest type
+	switch (mode) {
+		case EAST_DATA_CHAR:
+			tmp.item_size = sizeof(char);
+			break;
+		case EAST_DATA_FLOAT:
+			tmp.item_size = sizeof(float);
+			break;
+		case EAST_DATA_DOUBLE:
+			tmp.item_size = sizeof(double);
+			break;
+		case EAST_DATA_INT:
+			tmp.item_size = sizeof(int32_t);
+			break;
+		case EAST_DATA_LONG:
+			tmp.item_size = sizeof(int64_t);
+			break;
+		default:
+			DATA_ERR("Unknown mode");
+	}
+
+	tmp.items = calloc(tmp.item_size, tmp.size);
 
 	// Handle OOM after allocation
 	if (!tmp.items)
@@ -40,17 +64,43 @@ void Data_Delete(data_t *D) {
 	D->mode = EAST_DATA_CHAR;
 }
 
-// Function only used on this file that doubles the size of the data_t structure, used for pushing
-static void DataDouble(data_t *D) {
-	D->size *= 2;
-
+// Double the size of the data_t structure, used for pushing
+void Data_Grow(data_t *D) {
 	// Allocate and handle OOM
-	ditem_t *tmp = realloc(D->items, sizeof(ditem_t)*D->size);
+	char *tmp = malloc(D->item_size*D->size*2);
 
 	if (!tmp)
 		DATA_ERR("Out of memory");
 
+	// Unwrap the items so they start at the first slot, keeping the direction they are stored in
+	size_t first = D->size - D->head;
+	if (first > D->length)
+		first = D->length;
+
+	memcpy(tmp, (char*)D->items + D->item_size*D->head, D->item_size*first);
+	memcpy(tmp + D->item_size*first, D->items, D->item_size*(D->length - first));
+
+	free(D->items);
 	D->items = tmp;
+	D->head = 0;
+	D->size *= 2;
+}
+
+// Function only used on this file that makes space for a new topmost item and returns its slot
+static size_t DataPushSlot(data_t *D) {
+	// Check if doubling is required
+	if (D->length+1 > D->size)
+		Data_Grow(D);
+
+	D->length++;
+
+	// When reversed, the top is at the head
+	if (D->reversed) {
+		D->head = (D->head - 1) & (D->size - 1);
+		return D->head;
+	}
+
+	return (D->head + D->length - 1) & (D->size - 1);
 }
 
 // Push a char to the data_t structure, doubling the size if necessary
@@ -58,88 +108,201 @@ void Data_PushC(data_t *D, char c) {
 	// This should always be true, but just in case
 	assert(D->mode == EAST_DATA_CHAR);
 
-	// Check if doubling is required
-	if (D->length+1 > D->size)
-		DataDouble(D);
-
-	// Actually push the character
-	D->items[D->length].c = c;
-	D->length++;
+	// Actually push the character, the slot has to be known before using the (maybe reallocated) items
+	size_t slot = DataPushSlot(D);
+	((char*)D->items)[slot] = c;
 }
 
 // The exact same as the above function, but push a float instead
 void Data_PushF(data_t *D, float f) {
 	assert(D->mode == EAST_DATA_FLOAT);
 
-	if (D->length+1 > D->size)
-		DataDouble(D);
-
-	D->items[D->length].f = f;
-	D->length++;
+	size_t slot = DataPushSlot(D);
+	((float*)D->items)[slot] = f;
 }
 
 // The exact same as the push char function, but push a double instead
 void Data_PushD(data_t *D, double d) {
 	assert(D->mode == EAST_DATA_DOUBLE);
 
-	if (D->length+1 > D->size)
-		DataDouble(D);
+	size_t slot = DataPushSlot(D);
+	((double*)D->items)[slot] = d;
+}
 
-	D->items[D->length].d = d;
-	D->length++;
+// Same for a 32 bit integer
+void Data_PushI(data_t *D, int32_t i) {
+	assert(D->mode == EAST_DATA_INT);
+
+	size_t slot = DataPushSlot(D);
+	((int32_t*)D->items)[slot] = i;
+}
+
+// And for a 64 bit one
+void Data_PushL(data_t *D, int64_t l) {
+	assert(D->mode == EAST_DATA_LONG);
+
+	size_t slot = DataPushSlot(D);
+	((int64_t*)D->items)[slot] = l;
 }
 
-// Pop a raw ditem_t, used in the functions below
-ditem_t Data_Pop(data_t *D) {
+// Push every character of a string, the last one ends up on top
+void Data_PushString(data_t *D, const char *string, size_t length) {
+	while (D->length + length > D->size)
+		Data_Grow(D);
+
+	size_t mask = D->size - 1;
+
+	// The usual case can be copied as is, in up to two parts as the ring may wrap
+	if (D->mode == EAST_DATA_CHAR && !D->reversed) {
+		size_t start = (D->head + D->length) & mask;
+		size_t first = D->size - start;
+		if (first > length)
+			first = length;
+
+		memcpy((char*)D->items + start, string, first);
+		memcpy(D->items, string + first, length - first);
+		D->length += length;
+		return;
+	}
+
+	switch (D->mode) {
+		case EAST_DATA_CHAR:
+			for (size_t i = 0; i < length; i++) {
+				size_t slot = DataPushSlot(D);
+				((char*)D->items)[slot] = string[i];
+			}
+			break;
+		case EAST_DATA_FLOAT:
+			for (size_t i = 0; i < length; i++) {
+				size_t slot = DataPushSlot(D);
+				((float*)D->items)[slot] = string[i];
+			}
+			break;
+		case EAST_DATA_DOUBLE:
+			for (size_t i = 0; i < length; i++) {
+				size_t slot = DataPushSlot(D);
+				((double*)D->items)[slot] = string[i];
+			}
+			break;
+		case EAST_DATA_INT:
+			for (size_t i = 0; i < length; i++) {
+				size_t slot = DataPushSlot(D);
+				((int32_t*)D->items)[slot] = string[i];
+			}
+			break;
+		case EAST_DATA_LONG:
+			for (size_t i = 0; i < length; i++) {
+				size_t slot = DataPushSlot(D);
+				((int64_t*)D->items)[slot] = string[i];
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+// Remove the topmost item without reading it, used in the functions below
+void Data_Drop(data_t *D) {
 	if (D->length == 0)
 		DATA_ERR("Data empty");
+
+	if (D->reversed)
+		D->head = (D->head + 1) & (D->size - 1);
 	D->length--;
-	ditem_t tmp = D->items[D->length];
-	D->items[D->length] = (ditem_t){0};
-	return tmp;
+}
+
+// Remove the n topmost items at once
+void Data_DropItems(data_t *D, size_t n) {
+	if (D->length < n)
+		DATA_ERR("Data empty");
+
+	if (D->reversed)
+		D->head = (D->head + n) & (D->size - 1);
+	D->length -= n;
 }
 
 // Pop a character from the data_t structure
 char Data_PopC(data_t *D) {
-	return Data_Pop(D).c;
+	assert(D->mode == EAST_DATA_CHAR);
+
+	if (D->length == 0)
+		DATA_ERR("Data empty");
+
+	char tmp = DATA_TOP(D, char);
+	Data_Drop(D);
+	return tmp;
 }
 
 // Pop a float from the data_t structure
 float Data_PopF(data_t *D) {
-	return Data_Pop(D).f;
+	assert(D->mode == EAST_DATA_FLOAT);
+
+	if (D->length == 0)
+		DATA_ERR("Data empty");
+
+	float tmp = DATA_TOP(D, float);
+	Data_Drop(D);
+	return tmp;
 }
 
 // Pop a double from the data_t structure
 double Data_PopD(data_t *D) {
-	return Data_Pop(D).d;
+	assert(D->mode == EAST_DATA_DOUBLE);
+
+	if (D->length == 0)
+		DATA_ERR("Data empty");
+
+	double tmp = DATA_TOP(D, double);
+	Data_Drop(D);
+	return tmp;
+}
+
+// Pop a 32 bit integer from the data_t structure
+int32_t Data_PopI(data_t *D) {
+	assert(D->mode == EAST_DATA_INT);
+
+	if (D->length == 0)
+		DATA_ERR("Data empty");
+
+	int32_t tmp = DATA_TOP(D, int32_t);
+	Data_Drop(D);
+	return tmp;
+}
+
+// Pop a 64 bit integer from the data_t structure
+int64_t Data_PopL(data_t *D) {
+	assert(D->mode == EAST_DATA_LONG);
+
+	if (D->length == 0)
+		DATA_ERR("Data empty");
+
+	int64_t tmp = DATA_TOP(D, int64_t);
+	Data_Drop(D);
+	return tmp;
 }
 
 // Rotate (123 -> 231) the items on the data_t structure
 void Data_Rotate(data_t *D) {
-	// First item on the data
-	ditem_t tmp = D->items[0];
+	size_t mask = D->size - 1;
+	char *items = D->items;
+	size_t n = D->item_size;
 
-	// Move every element one slot backwards
-	for (size_t i = 0; i < D->length; i++)
-		D->items[i] = D->items[i+1];
+	if (D->length == 0)
+		return;
 
-	// Set what used to be the first item to be the last one
-	D->items[D->length-1] = tmp;
+	// Copy the bottom item to the slot after the top one and move the head past it
+	// If the data is full, that slot is the bottom one, so only the head moves
+	if (D->reversed) {
+		D->head = (D->head - 1) & mask;
+		memcpy(items + n*D->head, items + n*((D->head + D->length) & mask), n);
+	} else {
+		memcpy(items + n*((D->head + D->length) & mask), items + n*D->head, n);
+		D->head = (D->head + 1) & mask;
+	}
 }
 
 // Reverse the items on the data_t data structure
 void Data_Reverse(data_t *D) {
-	// Create another items container to hold the reversed items
-	ditem_t *tmp = calloc(sizeof(ditem_t), D->size);
-
-	// Use a single for loop to reverse the entire items array
-	size_t old_i = 0;
-	size_t new_i = 0;
-	for (new_i = 0, old_i = D->length-1; new_i < D->length; new_i++, old_i--)
-		tmp[new_i] = D->items[old_i];
-
-	// Delete the old, not reversed array
-	free(D->items);
-	// Replace it with the new, reversed array
-	D->items = tmp;
+	// Only the direction changes, the items stay where they are
+	D->reversed = !D->reversed;
 }
@@ -21,42 +21,79 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <assert.h>
 
-#define DATA_ERR(msg) do {fprintf(stderr,"East, fatal error: %s\n", msg);exit(1);} while (0)
+#include "error.h"
 
-// Modes (AKA what type it uses) for the data
+#define DATA_ERR(msg) Error_Raise(msg, 0, 0)
+
+// Modes (AKA what type it uses) for the data, in the same order as east_mode_t
 typedef enum {
+	EAST_DATA_CHAR,
 	EAST_DATA_FLOAT,
 	EAST_DATA_DOUBLE,
-	EAST_DATA_CHAR
+	EAST_DATA_INT,
+	EAST_DATA_LONG,
+	EAST_DATA_MODES
 } dmode_t;
 
-// Individual data item
-typedef union {
-	double d;
-	float f;
-	char c;
-} ditem_t;
-
 // Structure which holds the main data structure
+// It is a circular deque, so rotating moves the head and reversing flips the direction
 typedef struct {
 	dmode_t mode;
-	ditem_t *items;
+	// Array of char, float, double, int32_t or int64_t depending on the mode, so each item only takes the size of its type
+	void *items;
+	size_t item_size;
+	// Slot of the bottom item, or of the top one if reversed
+	size_t head;
 	size_t length;
+	// Always a power of two
 	size_t size;
+	int reversed;
 } data_t;
 
+// Slot where the i-th item from the bottom is stored
+#define DATA_SLOT(D, i) \
+	(((D)->reversed ? (D)->head + (D)->length - 1 - (i) : (D)->head + (i)) & ((D)->size - 1))
+
+// The i-th item from the bottom and the topmost item, type has to be the one of the mode
+#define DATA_AT(D, type, i) (((type*)(D)->items)[DATA_SLOT(D, i)])
+#define DATA_TOP(D, type) DATA_AT(D, type, (D)->length - 1)
+
+// Code specialized for each mode is written once and included with MODE_S (the suffix, C, F, D, I or L), MODE_T (the type) and MODE_W (the type math is done on) defined
+// MODE_NAME(Data_Push) becomes Data_PushC on char mode, for example
+#define MODE_CAT_(name, suffix) name##suffix
+#define MODE_CAT(name, suffix) MODE_CAT_(name, suffix)
+#define MODE_NAME(name) MODE_CAT(name, MODE_S)
+
+// Math between two items, the integer modes do it unsigned so it wraps around instead of overflowing
+#define MODE_ADD(b, a) ((MODE_T)((MODE_W)(b) + (MODE_W)(a)))
+#define MODE_SUB(b, a) ((MODE_T)((MODE_W)(b) - (MODE_W)(a)))
+#define MODE_MULT(b, a) ((MODE_T)((MODE_W)(b) * (MODE_W)(a)))
+
+// Dividing by 0 divides by 1, and integers negate when dividing by -1 as the lowest one would overflow (floating point modes fold the check away)
+#define MODE_INTEGER ((MODE_T)0.5 == 0)
+#define MODE_DIV(b, a) (((a) == 0) ? (b) : (MODE_INTEGER && (a) == -1) ? MODE_SUB(0, b) : (MODE_T)((b) / (a)))
+
 // Functions expprted to other files
 data_t Data_Create(dmode_t mode);
 void Data_Delete(data_t *D);
+void Data_Grow(data_t *D);
 void Data_PushC(data_t *D, char c);
 void Data_PushF(data_t *D, float f);
 void Data_PushD(data_t *D, double d);
-ditem_t Data_Pop(data_t *D);
+void Data_PushI(data_t *D, int32_t i);
+void Data_PushL(data_t *D, int64_t l);
+void Data_PushString(data_t *D, const char *string, size_t length);
+void Data_Drop(data_t *D);
+void Data_DropItems(data_t *D, size_t n);
 char Data_PopC(data_t *D);
 float Data_PopF(data_t *D);
 double Data_PopD(data_t *D);
+int32_t Data_PopI(data_t *D);
+int64_t Data_PopL(data_t *D);
 void Data_Rotate(data_t *D);
 void Data_Reverse(data_t *D);
 
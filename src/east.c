@@ -26,13 +26,27 @@ One argument mode only:\n\
  -C Show copyright\n\
  -V Show version (East x.x.x)\n\
  -h Show help\n\
+ -S Serve requests from standard input, with -u, -J, -s and -rN on the same argument (format on the README)\n\
 \n\
 Two or three argument mode only:\n\
  -c Use char mode (the default)\n\
  -f Use float mode\n\
  -d Use double mode\n\
+ -i Use 32 bit integer mode\n\
+ -l Use 64 bit integer mode\n\
  -n Don't use an input file or read standard input\n\
- -F Read script from the file instead of from the argument directly")
+ -F Read script from the file instead of from the argument directly\n\
+ -t Flush the output after every newline when it is a terminal\n\
+ -u Don't replace common idioms with fused instructions or drop the checks proven unneeded\n\
+ -J Compile the script to native code (x86-64 only, ignored elsewhere)\n\
+ -s Print statistics to standard error on exit (not with -j or -L)\n\
+ -P[n] Print how many times each instruction ran to standard error on exit, -P1 times them too, -P2 and -P3 print them by call stack for flamegraph.pl (needs make PROFILE=1, not with -j or -L)\n\
+ -rN Allow up to N nested `=` and `$` calls (100000 by default)\n\
+ -L[N] Run the script on every line of the input on its own, or on every record ended by the character N, in parallel (-jN sets how many at once)\n\
+\n\
+Batch mode:\n\
+east -jN script file... (other flags go on the same argument, as in -dj4)\n\
+ -jN Run the script on every file, N at once (0 for one per core), the outputs are written in order")
 
 #define WARRANTY puts("This program is distributed in the hope that it will be useful,\n\
 but WITHOUT ANY WARRANTY; without even the implied warranty of\n\
@@ -47,50 +61,141 @@ the Free Software Foundation, either version 3 of the License, or\n\
 (at your option) any later version.")
 
 #define EAST_ERR(msg) do {fprintf(stderr,"East: %s\n", msg); exit(1);} while(0)
-#define EAST_FILESIZE_LIMIT 1073741824 // 1 GiB
 
-#include "instructions.h"
+// STDOUT_FILENO is POSIX
+#define _POSIX_C_SOURCE 200112L
+#include <unistd.h>
+#include <string.h>
+
+#include "libeast.h"
+#include "batch.h"
+#include "server.h"
 #include "util.h"
 #include "sargp.h"
 
-// Execute a string on an isolated container, only provides access to the data and the input string
-void ExecuteString(char *string, data_t *data, inst_t *instr, uinst_t **userinstr, char *input) {
-	East_State E;
-	// Program counter
-	E.pc = 0;
-	// Current character on the input string
-	E.input_index = 0;
-	// Waypoints for both of the previous variables, used to go back
-	E.data_waypoint  = WP_Create();
-	E.input_waypoint = WP_Create();
-
-	E.exec  = string;
-	E.input = input;
-	E.data  = *data;
-	E.instr = instr;
-	E.userinstr = *userinstr;
-
-	// Execute the instruction given in the table
-	for (E.pc = 0; E.pc < strlen(string); E.pc++) {
-		// Execute instruction if the current character is not a newline or a space, since they are used for readability
-		if (!(string[E.pc] == '\n' || string[E.pc] == ' ' || string[E.pc] == '\t'))
-			// Cast to int because characters can't be array sunscripts, but literal characters can
-			instr[(int)string[E.pc]](&E);
+// Engine of the whole run (see libeast.h), made with options once the flags are parsed
+static east_t *east;
+static east_options_t options;
+// Where the engine of -S writes, kept until EndRun deletes the engine
+static server_t server_out;
+
+// Flags only the command line has
+// Print statistics on exit (-s)
+static int stats = 0;
+// Run the script on every record of the input instead, split on delim (-L)
+static int records = 0;
+static char delim = '\n';
+// Processes running files (-j) or records at once, 0 for one per core
+static size_t workers = 0;
+// Count the instructions run (-P), 2 to time them too (-P1), 3 and 4 to count or time them by call stack (-P2, -P3), and what the script is called on the report
+static int profile = 0;
+static const char *script_name = "script";
+
+// Print the stats and the profile, then free the engine (its runs already flushed their output)
+static void EndRun(void) {
+	if (!east)
+		return;
+
+	if (stats) {
+		east_stats_t S;
+		East_Stats(east, &S);
+
+		fprintf(stderr, "East, stats:\n");
+		fprintf(stderr, " `=` cache: %zu hits, %zu misses\n", S.exec_hits, S.exec_misses);
+		fprintf(stderr, " calls: %zu (%zu tail calls), %zu waypoint stacks allocated\n", S.calls, S.tail_calls, S.wp_creates);
+		fprintf(stderr, " pool: %zu blocks allocated, %zu reused\n", S.pool_mallocs, S.pool_reuses);
+	}
+
+	if (profile)
+		East_Profile(east, stderr, script_name);
+
+	East_Delete(east);
+	east = NULL;
+}
+
+// Each worker of -j and -L counts on its own, and the parent never sees what they counted
+static void CheckParallel(int batch) {
+	if ((batch || records) && (stats || profile))
+		EAST_ERR("-s and -P can't be used with -j or -L");
+}
+
+static void CreateEngine(void) {
+	options.profile = profile;
+#ifndef EAST_PROFILE
+	if (profile)
+		fprintf(stderr, "East, warning: Built without the profiler, -P needs make PROFILE=1\n");
+#endif
+
+	east = East_Create(&options);
+
+	if (!east)
+		EAST_ERR("Out of memory");
+}
+
+// Compile the script for the engine, which only fails without memory (mistakes on the script are errors of the runs)
+static east_script_t *CompileScript(char *script, size_t size) {
+	east_error_t error;
+	east_script_t *S = East_Compile(east, script, size, &error);
+
+	if (!S) {
+		East_PrintError(&error, stderr);
+		exit(1);
 	}
 
-	// Cleanup
-	WP_Delete(&E.data_waypoint);
-	WP_Delete(&E.input_waypoint);
-	*data = E.data;
+	return S;
+}
+
+// Execute the script as the flags say, record mode (-L) ends the program here
+static void RunScript(char *script, size_t size, east_mode_t mode, char *input, size_t input_length) {
+	east_script_t *S = CompileScript(script, size);
+
+	if (!records) {
+		east_error_t error;
+
+		if (East_Run(east, S, mode, input, input_length, &error) != EAST_OK) {
+			East_PrintError(&error, stderr);
+			exit(1);
+		}
+
+		East_ScriptDelete(east, S);
+		return;
+	}
+
+	size_t failed = Batch_Records(&options, S, mode, input, input_length, delim, workers);
+
+	// Every record already ended its output with a newline
+	East_ScriptDelete(east, S);
+	exit(failed ? 1 : 0);
+}
+
+// Number right after a flag (as in -r500), leaves the argument on its last digit
+static size_t FlagNumber(char **arg) {
+	char *end;
+	size_t n = strtoul(*arg+1, &end, 10);
+
+	if (end == *arg+1)
+		EAST_ERR("Expected a number after the flag");
+
+	*arg = end-1;
+	return n;
 }
 
 int main(int argc, char **argv) {
 	// Default initialization
 	size_t input_length = 0;
 	char *input;
-	dmode_t mode = EAST_DATA_CHAR;
+	east_mode_t mode = EAST_MODE_CHAR;
 	int use_input = 1;
 	int use_script_file = 0;
+	// Set by -j, runs the script on every file after it (unless -L is used too)
+	int batch = 0;
+	// Set by -S, serves requests from standard input instead
+	int server = 0;
+
+	East_Options(&options);
+	options.fd = STDOUT_FILENO;
+
+	atexit(EndRun);
 
 	// Argument parsing starts here
 	switch (argc-1) {
@@ -115,18 +220,39 @@ int main(int argc, char **argv) {
 				case 'C':
 					COPYRIGHT;
 					break;
+				// Flags of the server
+				case 'S':
+					server = 1;
+					break;
+				case 'u':
+					options.optimize = 0;
+					break;
+				case 'J':
+					options.jit = 1;
+					break;
+				case 's':
+					stats = 1;
+					break;
+				case 'r':
+					options.max_depth = FlagNumber(&argv[1]);
+					break;
 				default:
 					fprintf(stderr,"East, warning: Unknown argument '-%c'\n", *argv[1]);
 					break;
-			}}return 0;}
+			}}
+
+			if (server) {
+				Server_Options(&server_out, &options);
+				CreateEngine();
+				return Server_Run(&server_out, east);
+			}
+			return 0;}
 
 			// Otherwise, load normally and get input from stdin
 			input = ReadStdin(&input_length);
-			inst_t *instructions = Inst_Get();
-			uinst_t *user_instructions = Inst_UCreate();
-			data_t data = Data_Create(mode);
+			CreateEngine();
 
-			ExecuteString(argv[1], &data, instructions, &user_instructions, input);
+			RunScript(argv[1], strlen(argv[1]), mode, input, input_length);
 			break;
 		}
 		// Check if it is 'flags, script' or 'script, file'. Act accordingly
@@ -134,13 +260,19 @@ int main(int argc, char **argv) {
 			// If at least one of those is chosen, the second arg is a script
 			ARGPARSE(argv[1]) {
 				case 'c':
-					mode = EAST_DATA_CHAR;
+					mode = EAST_MODE_CHAR;
 					break;
 				case 'f':
-					mode = EAST_DATA_FLOAT;
+					mode = EAST_MODE_FLOAT;
 					break;
 				case 'd':
-					mode = EAST_DATA_DOUBLE;
+					mode = EAST_MODE_DOUBLE;
+					break;
+				case 'i':
+					mode = EAST_MODE_INT;
+					break;
+				case 'l':
+					mode = EAST_MODE_LONG;
 					break;
 				case 'n':
 					use_input = 0;
@@ -148,22 +280,52 @@ int main(int argc, char **argv) {
 				case 'F':
 					use_script_file = 1;
 					break;
+				case 't':
+					options.line_flush = 1;
+					break;
+				case 'u':
+					options.optimize = 0;
+					break;
+				case 'J':
+					options.jit = 1;
+					break;
+				case 's':
+					stats = 1;
+					break;
+				case 'r':
+					options.max_depth = FlagNumber(&argv[1]);
+					break;
+				case 'j':
+					workers = FlagNumber(&argv[1]);
+					break;
+				case 'P':
+					profile = 1;
+					// Timing and call stacks are optional, as -P1 to -P3
+					if (argv[1][1] >= '0' && argv[1][1] <= '9') {
+						size_t level = FlagNumber(&argv[1]);
+						profile += (level < 3) ? (int)level : 3;
+					}
+					break;
+				case 'L':
+					records = 1;
+					if (argv[1][1] >= '0' && argv[1][1] <= '9')
+						delim = (char)FlagNumber(&argv[1]);
+					break;
 				default:
 					fprintf(stderr,"East, warning: Unknown argument '-%c'\n", *argv[1]);
 					break;
 			}}
+				CheckParallel(0);
+
 				// The usual preparation for execution
-				inst_t *instructions = Inst_Get();
-				uinst_t *user_instructions = Inst_UCreate();
-				data_t data = Data_Create(mode);
+				CreateEngine();
 
 				if (use_input) {
-					// The '_' is a unused variable
-					size_t _;
-					input = ReadStdin(&_);
+					input = ReadStdin(&input_length);
 				} else {
 					// This is so you can use square brackets to do loops
 					input = "0";
+					input_length = 1;
 				}
 
 				// Read the East code from a file (whose filename was supplied on the given argument)
@@ -173,24 +335,21 @@ int main(int argc, char **argv) {
 					if (fp == NULL)
 						EAST_ERR("No such file");
 
-					size_t unused;
+					size_t size;
+					char *script = MapFile(&size, fp);
+					script_name = argv[2];
 
 					// Execute normally
-					ExecuteString(ReadFile(&unused, fp), &data, instructions, &user_instructions, input);
+					RunScript(script, size, mode, input, input_length);
 
 					fclose(fp);
 				} else {
 					// Execute as in older versions
-					ExecuteString(argv[2], &data, instructions, &user_instructions, input);
+					RunScript(argv[2], strlen(argv[2]), mode, input, input_length);
 				}
-
-				// Usual cleanup
-				Data_Delete(&data);
 			} else {
 				// This is how East was executed before command line parsing
-				inst_t *instructions = Inst_Get();
-				uinst_t *user_instructions = Inst_UCreate();
-				data_t data = Data_Create(mode);
+				CreateEngine();
 
 				FILE *fp = fopen(argv[2], "r");
 
@@ -198,28 +357,34 @@ int main(int argc, char **argv) {
 					EAST_ERR("No such file");
 
 				// Input comes from the given file
-				input = ReadFile(&input_length, fp);
+				input = MapFile(&input_length, fp);
 
 				fclose(fp);
 
 				// Code comes from the first argument and gets executed
-				ExecuteString(argv[1], &data, instructions, &user_instructions, input);
-
-				Data_Delete(&data);
+				RunScript(argv[1], strlen(argv[1]), mode, input, input_length);
 			}
 			break;
 		}
-		case 3: {
+		// More files are only allowed on batch mode
+		case 3:
+		default: {
 			// Same argument parsing as before
 			ARGPARSE(argv[1]) {
 				case 'c':
-					mode = EAST_DATA_CHAR;
+					mode = EAST_MODE_CHAR;
 					break;
 				case 'f':
-					mode = EAST_DATA_FLOAT;
+					mode = EAST_MODE_FLOAT;
 					break;
 				case 'd':
-					mode = EAST_DATA_DOUBLE;
+					mode = EAST_MODE_DOUBLE;
+					break;
+				case 'i':
+					mode = EAST_MODE_INT;
+					break;
+				case 'l':
+					mode = EAST_MODE_LONG;
 					break;
 				case 'n':
 					use_input = 0;
@@ -227,15 +392,76 @@ int main(int argc, char **argv) {
 				case 'F':
 					use_script_file = 1;
 					break;
+				case 't':
+					options.line_flush = 1;
+					break;
+				case 'u':
+					options.optimize = 0;
+					break;
+				case 'J':
+					options.jit = 1;
+					break;
+				case 's':
+					stats = 1;
+					break;
+				case 'r':
+					options.max_depth = FlagNumber(&argv[1]);
+					break;
+				case 'j':
+					batch = 1;
+					workers = FlagNumber(&argv[1]);
+					break;
+				case 'P':
+					profile = 1;
+					// Timing and call stacks are optional, as -P1 to -P3
+					if (argv[1][1] >= '0' && argv[1][1] <= '9') {
+						size_t level = FlagNumber(&argv[1]);
+						profile += (level < 3) ? (int)level : 3;
+					}
+					break;
+				case 'L':
+					records = 1;
+					// The delimiter is optional, as a number
+					if (argv[1][1] >= '0' && argv[1][1] <= '9')
+						delim = (char)FlagNumber(&argv[1]);
+					break;
 				default:
 					fprintf(stderr,"East, warning: Unknown argument '-%c'\n", *argv[1]);
 					break;
 			} ARGEND
 
+			CheckParallel(batch);
+
+			if (batch && !records) {
+				char *script = argv[2];
+				size_t size = strlen(argv[2]);
+
+				if (use_script_file) {
+					FILE *fp = fopen(argv[2], "r");
+
+					if (fp == NULL)
+						EAST_ERR("No such file");
+
+					script = MapFile(&size, fp);
+					fclose(fp);
+				}
+
+				// Compiled once, every worker gets a copy when forked
+				CreateEngine();
+				east_script_t *S = CompileScript(script, size);
+
+				size_t failed = Batch_Files(&options, S, mode, argv+3, argc-3, workers);
+
+				// Every output already ends with a newline
+				East_ScriptDelete(east, S);
+				return failed ? 1 : 0;
+			} else if (argc-1 > 3) {
+				USAGE;
+				return 1;
+			}
+
 			// Same preparation
-			inst_t *instructions = Inst_Get();
-			uinst_t *user_instructions = Inst_UCreate();
-			data_t data = Data_Create(mode);
+			CreateEngine();
 
 			// Same check for -n flag
 			if (use_input) {
@@ -244,12 +470,13 @@ int main(int argc, char **argv) {
 				if (fp == NULL)
 					EAST_ERR("No such file");
 
-				input = ReadFile(&input_length, fp);
+				input = MapFile(&input_length, fp);
 
 				fclose(fp);
 			} else {
 				// Used like this because of []
 				input = "0";
+				input_length = 1;
 			}
 
 			// Same check for script file
@@ -260,24 +487,20 @@ int main(int argc, char **argv) {
 					EAST_ERR("No such file");
 
 				size_t size;
+				char *script = MapFile(&size, fp);
+				script_name = argv[2];
 
-				ExecuteString(ReadFile(&size, fp), &data, instructions, &user_instructions, input);
+				RunScript(script, size, mode, input, input_length);
 
 				fclose(fp);
 			} else {
-				ExecuteString(argv[2], &data, instructions, &user_instructions, input);
+				RunScript(argv[2], strlen(argv[2]), mode, input, input_length);
 			}
-
-			// Same cleanup
-			Data_Delete(&data);
 			break;
 		}
-		// Show usage to help newcomers
-		default:
-			USAGE;
-			break;
 	}
 
-	// This is for pretty output and also to flush stdout
+	// This is for pretty output, after what the run wrote (already flushed by East_Run) and before the stats
 	putchar('\n');
+	fflush(stdout);
 }
@@ -0,0 +1,182 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "engine.h"
+
+// Count every instruction before it runs, only built in with EAST_PROFILE so the engine doesn't pay for it otherwise
+#ifdef EAST_PROFILE
+#define PROFILE() do { if (profile) Prof_Step(profile, E, pc); } while (0)
+#else
+#define PROFILE() do {} while (0)
+#endif
+
+#ifdef EAST_COMPUTED_GOTO
+// Labels as values are a GNU extension, the tables of them are marked with __extension__ and only the goto skips -Wpedantic
+#define TARGET(op) L_##op
+#define GOTO(target) _Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Wpedantic\"") goto *(target); _Pragma("GCC diagnostic pop")
+#define DISPATCH() { PROFILE(); GOTO(targets[ops[pc].op]) }
+#else
+#define TARGET(op) case op
+#define DISPATCH() { PROFILE(); continue; }
+#endif
+
+// Go to the next instruction or to the given one
+#define NEXT() { pc++; DISPATCH(); }
+#define JUMP(target) { pc = (target); DISPATCH(); }
+
+// Write the local copies of the state back to E, for everything that reads it from there
+#define SYNC() do { E->pc = pc; E->input_index = input_index; E->data.head = head; E->data.length = length; E->data.reversed = reversed; } while (0)
+
+// Read them again, the data may have been reallocated
+#define LOAD() do { pc = E->pc; input_index = E->input_index; LOAD_DATA(); } while (0)
+#define LOAD_DATA() do { items = E->data.items; head = E->data.head; length = E->data.length; mask = E->data.size - 1; reversed = E->data.reversed; } while (0)
+
+// Use the instruction from the table, for the ones that aren't worth handling here
+#define CALL(handler) do { SYNC(); handler(E); LOAD(); } while (0)
+
+#define ENGINE_ERR(msg) do { SYNC(); INST_ERR(msg); } while (0)
+
+// Same as DATA_SLOT, with the local copies
+#define SLOT(i) ((reversed ? head + length - 1 - (i) : head + (i)) & mask)
+#define TOP SLOT(length-1)
+
+// Make space for a new topmost item, the slot ends up in TOP
+#define GROW() do { \
+	if (length+1 > mask+1) { \
+		SYNC(); \
+		Data_Grow(&E->data); \
+		LOAD_DATA(); \
+	} \
+	if (reversed) \
+		head = (head - 1) & mask; \
+	length++; \
+} while (0)
+
+// And remove the topmost one
+#define SHRINK() do { \
+	if (reversed) \
+		head = (head + 1) & mask; \
+	length--; \
+} while (0)
+
+// Push an item, casted to the type of the mode
+#define PUSH(value) do { \
+	GROW(); \
+	items[TOP] = (value); \
+} while (0)
+
+// Same as INST_MATH_OP, the result goes where the second item was
+#define MATH_OP(op) do { \
+	if (length < 2) \
+		ENGINE_ERR("Data empty"); \
+	SAFE_MATH_OP(op); \
+} while (0)
+
+// For when the compiler proved there are two items
+#define SAFE_MATH_OP(op) do { \
+	size_t second = SLOT(length-2); \
+	MODE_T a = items[TOP]; \
+	MODE_T b = items[second]; \
+	items[second] = op; \
+	SHRINK(); \
+} while (0)
+
+#ifndef EAST_TABLE_ENGINE
+// One engine for each mode, so the items are accessed with their own type
+#define MODE_S C
+#define MODE_T char
+#define MODE_W int
+#include "enginemode.h"
+
+#define MODE_S F
+#define MODE_T float
+#define MODE_W float
+#include "enginemode.h"
+
+#define MODE_S D
+#define MODE_T double
+#define MODE_W double
+#include "enginemode.h"
+
+#define MODE_S I
+#define MODE_T int32_t
+#define MODE_W uint32_t
+#include "enginemode.h"
+
+#define MODE_S L
+#define MODE_T int64_t
+#define MODE_W uint64_t
+#include "enginemode.h"
+#endif
+
+void Engine_Run(East_State *E) {
+#ifdef EAST_TABLE_ENGINE
+	// Execute the instruction given in the table, kept as a reference for the threaded engine
+	for (;; E->pc++) {
+		if (E->code->ops[E->pc].op == OP_END) {
+			if (E->frames_length == E->frames_base)
+				return;
+			Inst_Return(E);
+			continue;
+		}
+
+#ifdef EAST_PROFILE
+		if (E->run->profile)
+			Prof_Step(E->run->profile, E, E->pc);
+#endif
+		E->instr[E->code->ops[E->pc].op](E);
+	}
+#else
+	switch (E->data.mode) {
+		case EAST_DATA_CHAR:
+			EngineRunC(E);
+			break;
+		case EAST_DATA_FLOAT:
+			EngineRunF(E);
+			break;
+		case EAST_DATA_DOUBLE:
+			EngineRunD(E);
+			break;
+		case EAST_DATA_INT:
+			EngineRunI(E);
+			break;
+		case EAST_DATA_LONG:
+			EngineRunL(E);
+			break;
+		default:
+			break;
+	}
+#endif
+}
+
+void Engine_Call(East_State *E) {
+	size_t base = E->frames_base;
+
+	// The caller can't be switched from (or reused), so the called code ends the loop
+	E->frames_base = E->frames_length + 1;
+	E->instr[E->code->ops[E->pc].op](E);
+
+	// Undeclared instructions don't switch
+	if (E->frames_length == E->frames_base) {
+		E->pc++;
+		Engine_Run(E);
+		Inst_Return(E);
+	}
+
+	E->frames_base = base;
+}
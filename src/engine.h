@@ -0,0 +1,34 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef EAST_ENGINE_H
+#define EAST_ENGINE_H
+
+#include "instructions.h"
+
+// Use computed goto where the compiler supports it, a switch otherwise (or if EAST_NO_COMPUTED_GOTO is defined)
+#if defined(__GNUC__) && !defined(EAST_NO_COMPUTED_GOTO)
+#define EAST_COMPUTED_GOTO
+#endif
+
+// Run the compiled code of E from E->pc until the OP_END of the code running when it started, `=` and `$` switch code inside the same loop
+void Engine_Run(East_State *E);
+// Run the `=` or `$` on E->pc until it returns, for callers that can't switch code (the native one)
+void Engine_Call(East_State *E);
+
+#endif // EAST_ENGINE_H
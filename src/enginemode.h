@@ -0,0 +1,335 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Threaded engine for a single mode, included by engine.c once per mode
+// Expects MODE_S (suffix), MODE_T (type) and MODE_W (type of the math) to be defined, no header guard on purpose
+
+static void MODE_NAME(EngineRun)(East_State *E) {
+	// The hot parts of the state live in locals while running
+	op_t *ops = E->code->ops;
+	pc_t pc = E->pc;
+	pc_t input_index = E->input_index;
+	char *input = E->input;
+	size_t input_length = E->input_length;
+	MODE_T *items = E->data.items;
+	size_t head = E->data.head;
+	size_t length = E->data.length;
+	size_t mask = E->data.size - 1;
+	int reversed = E->data.reversed;
+	out_t *out = &E->run->out;
+#ifdef EAST_PROFILE
+	prof_t *profile = E->run->profile;
+#endif
+
+#ifdef EAST_COMPUTED_GOTO
+	__extension__ static void *targets[OP_COUNT] = {
+		[OP_NEXTCHAR]    = &&L_OP_NEXTCHAR,
+		[OP_PREVCHAR]    = &&L_OP_PREVCHAR,
+		[OP_PUSHITEM]    = &&L_OP_PUSHITEM,
+		[OP_POPITEM]     = &&L_OP_POPITEM,
+		[OP_DUPITEM]     = &&L_OP_DUPITEM,
+		[OP_PRINTCHAR]   = &&L_OP_PRINTCHAR,
+		[OP_PRINTNUMBER] = &&L_OP_PRINTNUMBER,
+		[OP_ADD]         = &&L_OP_ADD,
+		[OP_SUB]         = &&L_OP_SUB,
+		[OP_MULT]        = &&L_OP_MULT,
+		[OP_DIV]         = &&L_OP_DIV,
+		[OP_REVERSE]     = &&L_OP_REVERSE,
+		[OP_ROTATE]      = &&L_OP_ROTATE,
+		[OP_EXECDATA]    = &&L_OP_EXECDATA,
+		[OP_PUSH]        = &&L_OP_PUSH,
+		[OP_SETINPUTWP]  = &&L_OP_SETINPUTWP,
+		[OP_USEINPUTWP]  = &&L_OP_USEINPUTWP,
+		[OP_SETDATAWP]   = &&L_OP_SETDATAWP,
+		[OP_USEDATAWP]   = &&L_OP_USEDATAWP,
+		[OP_INPUTLOOP]   = &&L_OP_INPUTLOOP,
+		[OP_DATALOOP]    = &&L_OP_DATALOOP,
+		[OP_IFNOTEQUAL]  = &&L_OP_IFNOTEQUAL,
+		[OP_FUNCDEC]     = &&L_OP_FUNCDEC,
+		[OP_FUNCEXEC]    = &&L_OP_FUNCEXEC,
+		[OP_JUMP]        = &&L_OP_JUMP,
+		[OP_ERROR]       = &&L_OP_ERROR,
+		[OP_PUSHINPUT]   = &&L_OP_PUSHINPUT,
+		[OP_CATINPUT]    = &&L_OP_CATINPUT,
+		[OP_PRINTDATA]   = &&L_OP_PRINTDATA,
+		[OP_ROTATEBACK]  = &&L_OP_ROTATEBACK,
+		[OP_ADDCONST]    = &&L_OP_ADDCONST,
+		[OP_SEGMAP]      = &&L_OP_SEGMAP,
+		[OP_SEGREDUCE]   = &&L_OP_SEGREDUCE,
+		[OP_SCAN]        = &&L_OP_SCAN,
+		[OP_SAFEPOP]     = &&L_OP_SAFEPOP,
+		[OP_SAFEDUP]     = &&L_OP_SAFEDUP,
+		[OP_SAFEPRINT]   = &&L_OP_SAFEPRINT,
+		[OP_SAFEADD]     = &&L_OP_SAFEADD,
+		[OP_SAFESUB]     = &&L_OP_SAFESUB,
+		[OP_SAFEMULT]    = &&L_OP_SAFEMULT,
+		[OP_SAFEDIV]     = &&L_OP_SAFEDIV,
+		[OP_SAFEADDCONST] = &&L_OP_SAFEADDCONST,
+		[OP_NOP]         = &&L_OP_NOP,
+		[OP_END]         = &&L_OP_END
+	};
+
+	DISPATCH();
+#else
+	PROFILE();
+	for (;;) switch (ops[pc].op) {
+#endif
+
+	// Input string operations
+	TARGET(OP_NEXTCHAR):
+		if (input_index < input_length)
+			input_index++;
+		NEXT();
+
+	TARGET(OP_PREVCHAR):
+		if (input_index > 0)
+			input_index--;
+		NEXT();
+
+	// Generic data operations
+	TARGET(OP_PUSHITEM):
+		PUSH((input_index < input_length) ? input[input_index] : '\0');
+		NEXT();
+
+	TARGET(OP_PUSH):
+		PUSH(ops[pc].arg);
+		NEXT();
+
+	TARGET(OP_POPITEM):
+		if (length == 0)
+			ENGINE_ERR("Data empty");
+		SHRINK();
+		NEXT();
+
+	TARGET(OP_DUPITEM):
+		if (length == 0)
+			ENGINE_ERR("Data empty");
+		GROW();
+		items[TOP] = items[SLOT(length-2)];
+		NEXT();
+
+	TARGET(OP_ADD):
+		MATH_OP(MODE_ADD(b, a));
+		NEXT();
+
+	TARGET(OP_SUB):
+		MATH_OP(MODE_SUB(b, a));
+		NEXT();
+
+	TARGET(OP_MULT):
+		MATH_OP(MODE_MULT(b, a));
+		NEXT();
+
+	TARGET(OP_DIV):
+		MATH_OP(MODE_DIV(b, a));
+		NEXT();
+
+	TARGET(OP_PRINTCHAR):
+		if (length == 0)
+			ENGINE_ERR("Data empty");
+		OUT_CHAR(out, items[TOP]);
+		SHRINK();
+		NEXT();
+
+	TARGET(OP_PRINTNUMBER):
+		CALL(MODE_NAME(inst_PrintNumber));
+		NEXT();
+
+	TARGET(OP_REVERSE):
+		reversed = !reversed;
+		NEXT();
+
+	TARGET(OP_ROTATE):
+		// Same as Data_Rotate
+		if (length != 0) {
+			if (reversed) {
+				head = (head - 1) & mask;
+				items[head] = items[(head + length) & mask];
+			} else {
+				items[(head + length) & mask] = items[head];
+				head = (head + 1) & mask;
+			}
+		}
+		NEXT();
+
+	// Both switch to other code, or back on OP_END
+	TARGET(OP_EXECDATA):
+		CALL(MODE_NAME(inst_ExecData));
+		ops = E->code->ops;
+		NEXT();
+
+	// Control statements
+	TARGET(OP_INPUTLOOP):
+		if (input_index < input_length)
+			JUMP(ops[pc].jump);
+		NEXT();
+
+	TARGET(OP_DATALOOP):
+		if (length != 0 && items[TOP] != 0)
+			JUMP(ops[pc].jump);
+		NEXT();
+
+	TARGET(OP_IFNOTEQUAL):
+		if (length < 2)
+			ENGINE_ERR("Data empty");
+		{
+			size_t top = TOP;
+			SHRINK();
+			if (items[top] == items[TOP])
+				JUMP(ops[pc].jump);
+		}
+		NEXT();
+
+	TARGET(OP_SETINPUTWP):
+		CALL(inst_SetInputWP);
+		NEXT();
+
+	TARGET(OP_USEINPUTWP):
+		CALL(inst_UseInputWP);
+		NEXT();
+
+	TARGET(OP_SETDATAWP):
+		CALL(inst_SetDataWP);
+		NEXT();
+
+	TARGET(OP_USEDATAWP):
+		CALL(MODE_NAME(inst_UseDataWP));
+		NEXT();
+
+	TARGET(OP_FUNCDEC):
+		CALL(inst_FuncDec);
+		NEXT();
+
+	TARGET(OP_FUNCEXEC):
+		CALL(inst_FuncExec);
+		ops = E->code->ops;
+		NEXT();
+
+	// Compiler generated instructions
+	TARGET(OP_JUMP):
+		JUMP(ops[pc].jump);
+
+	TARGET(OP_ERROR):
+		CALL(inst_Error);
+		NEXT();
+
+	// Fused idioms
+	TARGET(OP_PUSHINPUT):
+		CALL(inst_PushInput);
+		NEXT();
+
+	TARGET(OP_CATINPUT):
+		CALL(inst_CatInput);
+		NEXT();
+
+	TARGET(OP_PRINTDATA):
+		if (length == 0)
+			ENGINE_ERR("Data empty");
+		do {
+			OUT_CHAR(out, items[TOP]);
+			SHRINK();
+		} while (length != 0 && items[TOP] != 0);
+		NEXT();
+
+	TARGET(OP_ROTATEBACK):
+		// Same as OP_ROTATE with the direction flipped
+		if (length != 0) {
+			if (!reversed) {
+				head = (head - 1) & mask;
+				items[head] = items[(head + length) & mask];
+			} else {
+				items[(head + length) & mask] = items[head];
+				head = (head + 1) & mask;
+			}
+		}
+		NEXT();
+
+	TARGET(OP_ADDCONST):
+		if (length == 0)
+			ENGINE_ERR("Data empty");
+		items[TOP] = MODE_ADD(items[TOP], (MODE_T)ops[pc].arg);
+		NEXT();
+
+	// Segment operations, the loops are in simd.c
+	TARGET(OP_SEGMAP):
+		CALL(MODE_NAME(inst_SegMap));
+		NEXT();
+
+	TARGET(OP_SEGREDUCE):
+		CALL(MODE_NAME(inst_SegReduce));
+		NEXT();
+
+	TARGET(OP_SCAN):
+		CALL(MODE_NAME(inst_Scan));
+		NEXT();
+
+	// Instructions the compiler proved to have enough items
+	TARGET(OP_SAFEPOP):
+		SHRINK();
+		NEXT();
+
+	TARGET(OP_SAFEDUP):
+		GROW();
+		items[TOP] = items[SLOT(length-2)];
+		NEXT();
+
+	TARGET(OP_SAFEPRINT):
+		OUT_CHAR(out, items[TOP]);
+		SHRINK();
+		NEXT();
+
+	TARGET(OP_SAFEADD):
+		SAFE_MATH_OP(MODE_ADD(b, a));
+		NEXT();
+
+	TARGET(OP_SAFESUB):
+		SAFE_MATH_OP(MODE_SUB(b, a));
+		NEXT();
+
+	TARGET(OP_SAFEMULT):
+		SAFE_MATH_OP(MODE_MULT(b, a));
+		NEXT();
+
+	TARGET(OP_SAFEDIV):
+		SAFE_MATH_OP(MODE_DIV(b, a));
+		NEXT();
+
+	TARGET(OP_SAFEADDCONST):
+		items[TOP] = MODE_ADD(items[TOP], (MODE_T)ops[pc].arg);
+		NEXT();
+
+	TARGET(OP_NOP):
+		NEXT();
+
+	TARGET(OP_END):
+		SYNC();
+		if (E->frames_length == E->frames_base)
+			return;
+		Inst_Return(E);
+		LOAD();
+		ops = E->code->ops;
+		NEXT();
+
+#ifndef EAST_COMPUTED_GOTO
+	}
+#endif
+}
+
+#undef MODE_S
+#undef MODE_T
+#undef MODE_W
@@ -0,0 +1,36 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "error.h"
+
+#include <stdlib.h>
+
+EAST_THREAD_LOCAL jmp_buf *Error_Jump = NULL;
+EAST_THREAD_LOCAL east_error_t Error_Last;
+
+void Error_Raise(const char *message, size_t position, char character) {
+	Error_Last.message = message;
+	Error_Last.position = position;
+	Error_Last.character = character;
+
+	if (Error_Jump)
+		longjmp(*Error_Jump, 1);
+
+	East_PrintError(&Error_Last, stderr);
+	exit(1);
+}
@@ -0,0 +1,47 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef EAST_ERROR_H
+#define EAST_ERROR_H
+
+#include <setjmp.h>
+#include <stdio.h>
+
+#include "libeast.h"
+
+// Each thread has its own errors, so engines can run on different threads at once
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define EAST_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define EAST_THREAD_LOCAL __thread
+#else
+#define EAST_THREAD_LOCAL
+#endif
+
+// Where errors go back to instead of exiting, set by callers that can recover (like the server), NULL to exit
+// Whoever sets it has to put the previous one back
+extern EAST_THREAD_LOCAL jmp_buf *Error_Jump;
+
+// The last error raised, for whoever caught it
+extern EAST_THREAD_LOCAL east_error_t Error_Last;
+
+// Called by every error of the interpreter, prints it and exits if nobody catches it
+void Error_Raise(const char *message, size_t position, char character);
+
+
+#endif // EAST_ERROR_H
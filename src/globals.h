@@ -27,32 +27,111 @@
 // Data structures
 #include "data.h"
 #include "wp.h"
-
-// Define the type used by the program counter and by the waypoints
-typedef size_t pc_t;
+#include "code.h"
+#include "out.h"
+#include "pool.h"
 
 struct East_State;
 
 // Function pointer for instruction array
 typedef void(*inst_t)(struct East_State*);
-typedef char* uinst_t;
+
+// User defined instruction, compiled once when declared
+typedef struct {
+	// Body of the instruction, owned so error messages can point into it
+	char *string;
+	size_t length;
+	code_t code;
+	// The table holds a reference, and so does every call running it, redefining it while running is fine
+	size_t refs;
+	// Where it and its string go back when freed
+	pool_t *pool;
+	// Name given by `%`, -1 for code run by `=`
+	int name;
+} func_t;
+
+// Table of user defined instructions (indexed by name), NULL if not declared
+typedef func_t* uinst_t;
+#define EAST_UINST_COUNT 256
+
+// Slots of the `=` cache, must be a power of 2
+#define EAST_EXEC_CACHE_SIZE 64
+
+// Default of run_t.max_depth
+#define EAST_MAX_DEPTH 100000
+
+// Everything shared by the code running on a run
+typedef struct {
+	out_t out;
+	// Replace common idioms with fused instructions, disabled with -u
+	int optimize;
+	// Compile the script to native code, enabled with -J
+	int jit;
+	// Nested `=` and `$` calls allowed, set with -r
+	size_t max_depth;
+	// Compiled code of the strings run by `=`, indexed by their hash
+	func_t *exec_cache[EAST_EXEC_CACHE_SIZE];
+	size_t exec_hits;
+	size_t exec_misses;
+	// Memory of user defined instructions and cached code, reused instead of going back to malloc
+	pool_t pool;
+	// `=` and `$` calls, the tail calls among them, and the waypoint stacks they had to allocate (the rest were reused)
+	size_t calls;
+	size_t tail_calls;
+	size_t wp_creates;
+	// Counts of the profiler, NULL unless enabled with -P (and built with EAST_PROFILE)
+	struct prof_t *profile;
+} run_t;
+
+// Caller of the running code, saved by `=` and `$`, which switch to the called code instead of recursing
+typedef struct {
+	char *exec;
+	size_t exec_length;
+	code_t *code;
+	pc_t pc;
+	pc_t input_index;
+	wp_t data_waypoint;
+	wp_t input_waypoint;
+	func_t *func;
+} frame_t;
 
 // State which holds all the relevant variables for executing East code
 typedef struct East_State {
 	char *exec;
+	size_t exec_length;
+	code_t *code;
 	char *input;
+	size_t input_length;
 	pc_t pc;
 	pc_t input_index;
 	wp_t data_waypoint;
 	wp_t input_waypoint;
 	data_t data;
-	inst_t *instr;
+	const inst_t *instr;
 	uinst_t *userinstr;
+	run_t *run;
+	// Reference held by the running code, NULL for the script
+	func_t *func;
+	// Callers of the running code, the slots above the length keep their waypoints for the next call
+	frame_t *frames;
+	size_t frames_length;
+	size_t frames_size;
+	// Reaching OP_END with this many callers ends the dispatch loop instead of returning
+	size_t frames_base;
 } East_State;
 
+// Engine of the library (libeast.h), a run and the buffers its scripts reuse
+struct east_t {
+	run_t run;
+	// One data for each mode, indexed by dmode_t
+	data_t data[EAST_DATA_MODES];
+	uinst_t *userinstr;
+};
+
 // Macro to easily define instructions
 #define INSTR(name) void name(East_State *E)
 
-void ExecuteString(char *string, data_t *data, inst_t *instr, uinst_t **userinstr, char *input);
+void ExecuteCode(char *string, size_t length, code_t *code, data_t *data, const inst_t *instr, uinst_t **userinstr, char *input, size_t input_length, run_t *run);
+void ExecuteString(char *string, size_t length, data_t *data, const inst_t *instr, uinst_t **userinstr, char *input, size_t input_length, run_t *run);
 
 #endif // EAST_GLOBALS_H
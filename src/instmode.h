@@ -0,0 +1,301 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Instructions that depend on the type of the items, included by instructions.c once per mode
+// Expects MODE_S (suffix), MODE_T (type), MODE_W (type of the math) and MODE_PRINT(O, n) (how `:` prints an item to O) to be defined, no header guard on purpose
+
+// Math operation on the two topmost items, the result replaces them
+#define INST_MATH_OP(op) do { \
+		if (E->data.length == 0) INST_ERR("Data empty"); \
+		MODE_T a = MODE_NAME(Data_Pop)(&E->data); \
+		if (E->data.length == 0) INST_ERR("Data empty"); \
+		MODE_T b = MODE_NAME(Data_Pop)(&E->data); \
+		MODE_NAME(Data_Push)(&E->data, op); \
+	} while (0)
+
+// (.) i->d( in -- char ) Push the current input character to the data, NUL if the input ended
+INSTR(MODE_NAME(inst_PushItem)) {
+	// Past the end of the input there is only NUL
+	char c = (E->input_index < E->input_length) ? E->input[E->input_index] : '\0';
+	MODE_NAME(Data_Push)(&E->data, c);
+}
+
+// (&) d( top -- copy copy ) Duplicate the topmost item from the data
+INSTR(MODE_NAME(inst_DupItem)) {
+	if (E->data.length == 0)
+		INST_ERR("Data empty");
+
+	MODE_NAME(Data_Push)(&E->data, DATA_TOP(&E->data, MODE_T));
+}
+
+// (;) d->i( top -- char ) Pop and print the topmost character from the data
+INSTR(MODE_NAME(inst_PrintChar)) {
+	if (E->data.length == 0)
+		INST_ERR("Data empty");
+
+	OUT_CHAR(&E->run->out, MODE_NAME(Data_Pop)(&E->data));
+}
+
+// (:) d->i( top -- number ) Pop and print the topmost character from the data as a number
+INSTR(MODE_NAME(inst_PrintNumber)) {
+	if (E->data.length == 0)
+		INST_ERR("Data empty");
+
+	MODE_PRINT(&E->run->out, MODE_NAME(Data_Pop)(&E->data));
+}
+
+// (+) d( item1 item2 -- result ) Add the two topmost items of the data
+INSTR(MODE_NAME(inst_AddData)) {
+	INST_MATH_OP(MODE_ADD(b, a));
+}
+
+// (-) d( item1 item2 -- result ) Substract the two topmost items of the data
+INSTR(MODE_NAME(inst_SubData)) {
+	INST_MATH_OP(MODE_SUB(b, a));
+}
+
+// (*) d( item1 item2 -- result ) Multiply the two topmost items of the data
+INSTR(MODE_NAME(inst_MultData)) {
+	INST_MATH_OP(MODE_MULT(b, a));
+}
+
+// (/) d( item1 item2 -- result ) Divide the two topmost items of the data, if the top one is 0, then it gets replaced with 1 to prevent "division by zero" errors
+INSTR(MODE_NAME(inst_DivData)) {
+	INST_MATH_OP(MODE_DIV(b, a));
+}
+
+// (=) d( until_NUL -- execute_result ) Read (not pop) everything until a NUL, reverse it, and execute it as East code, only being able to modify the data (the rest is isolated)
+INSTR(MODE_NAME(inst_ExecData)) {
+	size_t i = E->data.length-1;
+
+	// Stops below the bottom if there is no NUL
+	while (i != (size_t)-1 && DATA_AT(&E->data, MODE_T, i) != 0) i--;
+	i++;
+
+	// Generated code tends to be run many times, so the compiled code is cached by contents
+	size_t length = E->data.length - i;
+	size_t hash = EXEC_HASH_INIT;
+	for (size_t j = i; j < E->data.length; j++)
+		hash = EXEC_HASH(hash, (char)DATA_AT(&E->data, MODE_T, j));
+
+	func_t **slot = &E->run->exec_cache[hash & (EAST_EXEC_CACHE_SIZE-1)];
+	func_t *F = *slot;
+
+	// Check that it really is the same string
+	size_t j = 0;
+	if (F && F->length == length)
+		while (j < length && F->string[j] == (char)DATA_AT(&E->data, MODE_T, i+j)) j++;
+
+	if (F && F->length == length && j == length) {
+		E->run->exec_hits++;
+	} else {
+		E->run->exec_misses++;
+
+		char *exec = Pool_Alloc(&E->run->pool, length + 1);
+
+		for (j = 0; j < length; j++)
+			exec[j] = (char)DATA_AT(&E->data, MODE_T, i+j);
+		exec[length] = '\0';
+
+		// Replaces whatever was on the slot
+		F = FuncCreate(E->run, exec, length, -1);
+		if (*slot)
+			Inst_Release(*slot);
+		*slot = F;
+	}
+
+	// Holds a reference while running, so a nested `=` can replace it
+	Inst_Call(E, F);
+}
+
+// ([a-z0-9]) e->d( char -- item ) Push the current character on the executed string
+INSTR(MODE_NAME(inst_PushLiteral)) {
+	MODE_NAME(Data_Push)(&E->data, INST_ARG);
+}
+
+// (}) c,d( waypoint,top -- ) Return (set pc) to the last data waypoint if the topmost item of the stack isn't NUL (or if the stack isn't empty)
+INSTR(MODE_NAME(inst_UseDataWP)) {
+	// Return if stack is empty
+	if (E->data.length == 0)
+		return;
+
+	// Check top item on the stack
+	if (DATA_TOP(&E->data, MODE_T)) {
+		pc_t tmp = (E->data_waypoint.length) ? WP_Pop(&E->data_waypoint) : E->code->restart;
+		INST_JUMP(tmp);
+	}
+}
+
+// Version of `}` paired with its `{` on compile time, which jumps without using waypoints
+INSTR(MODE_NAME(inst_DataLoop)) {
+	if (E->data.length != 0 && DATA_TOP(&E->data, MODE_T))
+		INST_JUMP(E->code->ops[E->pc].jump);
+}
+
+// (?) d,c( top :2nd -- skip1 ) If the top two items on the data are equal, the next instruction is skipped, otherwise, it is executed. The last element of the data is always popped
+INSTR(MODE_NAME(inst_IfNotEqual)) {
+	// There has to be a second item to compare with
+	if (E->data.length < 2)
+		INST_ERR("Data empty");
+
+	MODE_T a = MODE_NAME(Data_Pop)(&E->data);
+	MODE_T b = DATA_TOP(&E->data, MODE_T);
+
+	// The compiler knows where the skip lands
+	if (b == a)
+		INST_JUMP(E->code->ops[E->pc].jump);
+}
+
+// Fused `{;}`, print the data until a NUL
+INSTR(MODE_NAME(inst_PrintData)) {
+	if (E->data.length == 0)
+		INST_ERR("Data empty");
+
+	// The first item is printed even if it is NUL
+	do {
+		OUT_CHAR(&E->run->out, MODE_NAME(Data_Pop)(&E->data));
+	} while (E->data.length != 0 && DATA_TOP(&E->data, MODE_T));
+}
+
+// Fused literal and `+`, add the literal to the topmost item
+INSTR(MODE_NAME(inst_AddConst)) {
+	if (E->data.length == 0)
+		INST_ERR("Data empty");
+
+	DATA_TOP(&E->data, MODE_T) = MODE_ADD(DATA_TOP(&E->data, MODE_T), (MODE_T)INST_ARG);
+}
+
+// (|+ |- |* |/) d( segment top -- segment ) Pop the top item and apply the math operation between each item above the topmost NUL (the whole data if there is none) and it, as in item+top for `|+`
+INSTR(MODE_NAME(inst_SegMap)) {
+	if (E->data.length == 0)
+		INST_ERR("Data empty");
+
+	MODE_T a = MODE_NAME(Data_Pop)(&E->data);
+	MODE_NAME(Simd_Map)(&E->data, MODE_NAME(Simd_Segment)(&E->data), (simd_op_t)INST_ARG, a);
+}
+
+// (|s |< |> |c) d( segment -- result ) Replace the items above the topmost NUL (the whole data if there is none) with their sum, minimum, maximum or count, 0 if there are none
+INSTR(MODE_NAME(inst_SegReduce)) {
+	size_t n = MODE_NAME(Simd_Segment)(&E->data);
+	simd_op_t op = (simd_op_t)INST_ARG;
+	MODE_T result = 0;
+
+	if (op == SIMD_ITEMS)
+		result = (MODE_T)n;
+	else if (n)
+		result = MODE_NAME(Simd_Reduce)(&E->data, n, op);
+
+	Data_DropItems(&E->data, n);
+	MODE_NAME(Data_Push)(&E->data, result);
+}
+
+// (|f |a) d,i( char/segment -- found ) Pop the top item (`|f`) or the items above the topmost NUL (`|a`) and go to the next character of the input that is one of them, starting from the current one
+// Push 1 if there was one, otherwise go to the end of the input and push 0
+INSTR(MODE_NAME(inst_Scan)) {
+	size_t n = (INST_ARG == SIMD_FIND) ? 1 : MODE_NAME(Simd_Segment)(&E->data);
+	unsigned char seen[256] = {0};
+	char set[256];
+	size_t length = 0;
+
+	// An empty segment is an empty set, only `|f` needs an item
+	if (n > E->data.length)
+		INST_ERR("Data empty");
+
+	// Only items equal to a char can match, the input is read as chars
+	for (size_t i = E->data.length - n; i < E->data.length; i++) {
+		MODE_T item = DATA_AT(&E->data, MODE_T, i);
+		if (!(item >= CHAR_MIN && item <= CHAR_MAX) || item != (MODE_T)(char)item)
+			continue;
+
+		unsigned char c = (unsigned char)(char)item;
+		if (!seen[c]) {
+			seen[c] = 1;
+			set[length++] = (char)c;
+		}
+	}
+	Data_DropItems(&E->data, n);
+
+	size_t start = (E->input_index < E->input_length) ? E->input_index : E->input_length;
+	size_t found = start + Simd_Scan(E->input + start, E->input_length - start, set, length);
+
+	E->input_index = found;
+	MODE_NAME(Data_Push)(&E->data, found < E->input_length);
+}
+
+// Table of this mode, the instructions that don't depend on it are shared
+static const inst_t MODE_NAME(Inst_Table)[OP_COUNT] = {
+	// Uses executed string
+	[OP_PUSH]        = MODE_NAME(inst_PushLiteral),
+
+	// Uses input string
+	[OP_PREVCHAR]    = inst_PrevChar,
+	[OP_NEXTCHAR]    = inst_NextChar,
+	// Uses on top data item
+	[OP_PUSHITEM]    = MODE_NAME(inst_PushItem),
+	[OP_POPITEM]     = inst_PopItem,
+	[OP_DUPITEM]     = MODE_NAME(inst_DupItem),
+	[OP_PRINTCHAR]   = MODE_NAME(inst_PrintChar),
+	[OP_PRINTNUMBER] = MODE_NAME(inst_PrintNumber),
+	// Uses topmost two stack items
+	[OP_ADD]         = MODE_NAME(inst_AddData),
+	[OP_SUB]         = MODE_NAME(inst_SubData),
+	[OP_MULT]        = MODE_NAME(inst_MultData),
+	[OP_DIV]         = MODE_NAME(inst_DivData),
+	// Uses entire stack
+	[OP_REVERSE]     = inst_ReverseData,
+	[OP_ROTATE]      = inst_RotateData,
+	// Uses until NUL
+	[OP_EXECDATA]    = MODE_NAME(inst_ExecData),
+	// Uses PC, controls the state of the interpreter
+	[OP_SETINPUTWP]  = inst_SetInputWP,
+	[OP_USEINPUTWP]  = inst_UseInputWP,
+	[OP_SETDATAWP]   = inst_SetDataWP,
+	[OP_USEDATAWP]   = MODE_NAME(inst_UseDataWP),
+	[OP_INPUTLOOP]   = inst_InputLoop,
+	[OP_DATALOOP]    = MODE_NAME(inst_DataLoop),
+	[OP_IFNOTEQUAL]  = MODE_NAME(inst_IfNotEqual),
+	[OP_JUMP]        = inst_Jump,
+	[OP_ERROR]       = inst_Error,
+	[OP_PUSHINPUT]   = inst_PushInput,
+	[OP_CATINPUT]    = inst_CatInput,
+	[OP_PRINTDATA]   = MODE_NAME(inst_PrintData),
+	[OP_ROTATEBACK]  = inst_RotateBack,
+	[OP_ADDCONST]    = MODE_NAME(inst_AddConst),
+	// Segments
+	[OP_SEGMAP]      = MODE_NAME(inst_SegMap),
+	[OP_SEGREDUCE]   = MODE_NAME(inst_SegReduce),
+	[OP_SCAN]        = MODE_NAME(inst_Scan),
+	// Proven to have enough items, the checks just never fail here
+	[OP_SAFEPOP]     = inst_PopItem,
+	[OP_SAFEDUP]     = MODE_NAME(inst_DupItem),
+	[OP_SAFEPRINT]   = MODE_NAME(inst_PrintChar),
+	[OP_SAFEADD]     = MODE_NAME(inst_AddData),
+	[OP_SAFESUB]     = MODE_NAME(inst_SubData),
+	[OP_SAFEMULT]    = MODE_NAME(inst_MultData),
+	[OP_SAFEDIV]     = MODE_NAME(inst_DivData),
+	[OP_SAFEADDCONST] = MODE_NAME(inst_AddConst),
+	// Functions
+	[OP_FUNCDEC]     = inst_FuncDec,
+	[OP_FUNCEXEC]    = inst_FuncExec
+};
+
+#undef INST_MATH_OP
+#undef MODE_S
+#undef MODE_T
+#undef MODE_W
+#undef MODE_PRINT
@@ -18,30 +18,11 @@
 
 #include "instructions.h"
 
-// Characters after escaping them
-char escaped[128] = {
-	'0','1','2','3','4','5','6','7','8',
-	'9','0','1','2','3','4','5','6','7',
-	'8','9','0','1','2','3','4','5','6',
-	'7','8','9','0','1',' ','!','"','#',
-	'$','%','&','\'','(',')','*','+',
-	',','-','.','/',0,1,2,3,4,5,6,7,8,9,
-	':',';','<','=','>','?','@','A','B',
-	'C','D','E','F','G','H','I','J','K',
-	'L','M','N','O','P','Q','R','S','T',
-	'U','V','W','X','Y','Z','[','\\',
-	']','^','_','`','\a','\b','c','d',
-	'\027','\f','g','h','i','j','k','l',
-	'm','\n','o','p','q','\r','s','\t',
-	'u','\v','w','x','y','z','{','|',
-	'}','~','H'
-};
-
 // Input string operations (read only)
 
 // (>) i( -- ) Go to the next character on the input string
 INSTR(inst_NextChar) {
-	if (E->input_index < strlen(E->input))
+	if (E->input_index < E->input_length)
 		E->input_index += 1;
 }
 
@@ -53,103 +34,11 @@ INSTR(inst_PrevChar) {
 
 // Generic data operations
 
-// (.) i->d( in -- char ) Push the current input character to the data
-INSTR(inst_PushItem) {
-	INST_PUSH_CASTED(E->input[E->input_index])
-}
-
 // (,) d( top -- ) Pop the topmost item from the data
 INSTR(inst_PopItem) {
 	if (E->data.length == 0)
 		INST_ERR("Data empty");
-	Data_Pop(&E->data);
-}
-
-// (&) d( top -- copy copy ) Duplicate the topmost item from the data
-INSTR(inst_DupItem) {
-	if (E->data.length == 0)
-		INST_ERR("Data empty");
-
-	// Handle modes
-	ditem_t item = Data_Pop(&E->data);
-	switch (E->data.mode) {
-		case EAST_DATA_CHAR:
-			Data_PushC(&E->data, item.c);
-			Data_PushC(&E->data, item.c);
-			break;
-		case EAST_DATA_FLOAT:
-			Data_PushF(&E->data, item.f);
-			Data_PushF(&E->data, item.f);
-			break;
-		case EAST_DATA_DOUBLE:
-			Data_PushD(&E->data, item.d);
-			Data_PushD(&E->data, item.d);
-			break;
-	}
-}
-
-// (;) d->i( top -- char ) Pop and print the topmost character from the data
-INSTR(inst_PrintChar) {
-	if (E->data.length == 0)
-		INST_ERR("Data empty");
-
-	switch (E->data.mode) {
-		case EAST_DATA_CHAR:
-			putchar(Data_PopC(&E->data));
-			break;
-		case EAST_DATA_FLOAT:
-			putchar(Data_PopF(&E->data));
-			break;
-		case EAST_DATA_DOUBLE:
-			putchar(Data_PopD(&E->data));
-			break;
-	}
-}
-
-// (:) d->i( top -- number ) Pop and print the topmost character from the data as a number
-INSTR(inst_PrintNumber) {
-	if (E->data.length == 0)
-		INST_ERR("Data empty");
-
-	switch (E->data.mode) {
-		case EAST_DATA_CHAR:
-			printf("%i", (signed char)Data_PopC(&E->data));
-			break;
-		case EAST_DATA_FLOAT:
-			printf("%f", Data_PopF(&E->data));
-			break;
-		case EAST_DATA_DOUBLE: {
-				double n = Data_PopD(&E->data);
-
-				// Print in scientific notation if it is bigger than one million, normal float like otherwise
-				if (n > 1e6) {
-					printf("%e", n);
-				} else {
-					printf("%f", n);
-				}
-				break;
-			}
-	}
-}
-
-// (+) d( item1 item2 -- result ) Add the two topmost items of the data
-INSTR(inst_AddData) {
-	INST_MATH_OP(b+a)
-}
-
-// (-) d( item1 item2 -- result ) Substract the two topmost items of the data
-INSTR(inst_SubData) {
-	INST_MATH_OP(b-a);
-}
-
-// (*) d( item1 item2 -- result ) Multiply the two topmost items of the data
-INSTR(inst_MultData) {
-	INST_MATH_OP(b*a);
-}
-
-// (/) d( item1 item2 -- result ) Divide the two topmost items of the data, if the top one is 0, then it gets replaced with 1 to prevent "division by zero" errors
-INSTR(inst_DivData) {
-	INST_MATH_OP(b / ((a != 0) ? a : 1) );
+	Data_Drop(&E->data);
 }
 
 // (!) d( everything -> reversed ) Reverse the entire data, for example, 'a' 'b' 'c' -> 'c' 'b' 'a'
@@ -162,292 +51,313 @@ INSTR(inst_RotateData) {
 	Data_Rotate(&E->data);
 }
 
-// (=) d( until_NUL -- execute_result ) Read (not pop) everything until a NUL, reverse it, and execute it as East code, only being able to modify the data (the rest is isolated)
-INSTR(inst_ExecData) {
-	size_t i = E->data.length-1;
-	size_t exec_i = 0;
-	size_t exec_s = 10;
-	char *exec = calloc(exec_s, sizeof(char));
-
-	switch (E->data.mode) {
-		case EAST_DATA_CHAR:
-			while (E->data.items[i].c != '\0') i--;
-			i++;
-
-			for (; i < E->data.length ; i++) {
-				if (exec_i > exec_s) {
-					exec_s *= 2;
-					char *tmp = realloc(exec, sizeof(char)*exec_s);
-					if (!tmp)
-						INST_ERR("Allocation failed, out of memory");
-					exec = tmp;
-				}
-				exec[exec_i] = E->data.items[i].c;
-				exec_i++;
-			}
-
-			ExecuteString(exec, &E->data, E->instr, &E->userinstr, E->input);
-			free(exec);
-
-			break;
-		case EAST_DATA_FLOAT:
-			while (E->data.items[i].f != 0) i++;
-			i--;
-
-			for (; i < E->data.length ; i++) {
-				if (exec_i > exec_s) {
-					exec_s *= 2;
-					char *tmp = realloc(exec, sizeof(char)*exec_s);
-					if (!tmp)
-						INST_ERR("Out of memory");
-					exec = tmp;
-				}
-				exec[exec_i] = (char)E->data.items[i].f;
-				exec_i++;
-			}
-
-			ExecuteString(exec, &E->data, E->instr, &E->userinstr, E->input);
-			free(exec);
-
-			break;
-		case EAST_DATA_DOUBLE:
-			while (E->data.items[i].d != 0) i++;
-			i--;
-
-			for (; i < E->data.length ; i++) {
-				if (exec_i > exec_s) {
-					exec_s *= 2;
-					char *tmp = realloc(exec, sizeof(char)*exec_s);
-					if (!tmp)
-						INST_ERR("Allocation failed, out of memory");
-					exec = tmp;
-				}
-				exec[exec_i] = (char)E->data.items[i].d;
-				exec_i++;
-			}
-
-			ExecuteString(exec, &E->data, E->instr, &E->userinstr, E->input);
-			free(exec);
-
-			break;
-	}
-}
-
-// ([a-z0-9]) e->d( char -- item ) Push the current character on the executed string
-INSTR(inst_PushLiteral) {
-	if (E->exec[E->pc] == '_') {
-		INST_PUSH_CASTED(' ');
-	} else {
-		INST_PUSH_CASTED(E->exec[E->pc]);
-	}
-}
-
-// (\) e->d( char -- escaped_item ) Push the following character escaped, based on the hardcoded "escaped" array
-INSTR(inst_PushEscaped) {
-	if (E->exec[E->pc+1]) {
-		INST_PUSH_CASTED(escaped[(size_t)E->exec[E->pc+1]]);
-		E->pc += 1;
-	} else {
-		INST_ERR("Expected a character to escape, got EOF");
-	}
-}
-
 // Control statements
 
 // ([) c( -- waypoint ) Set the waypoint used in `]`, which checks the input character
 INSTR(inst_SetInputWP) {
-	WP_Push(&E->input_waypoint, E->pc-1);
+	WP_Push(&E->input_waypoint, E->pc);
 }
 
-// (]) c,i( waypoint,current -- ) Return (set pc) to the last input waypoint if the current character on the input string is not NUL
+// (]) c,i( waypoint,current -- ) Return (set pc) to the last input waypoint if the end of the input string hasn't been reached
 INSTR(inst_UseInputWP) {
-	if (E->input[E->input_index]) {
-		pc_t tmp = WP_Pop(&E->input_waypoint);
-		E->pc = tmp;
+	if (E->input_index < E->input_length) {
+		pc_t tmp = (E->input_waypoint.length) ? WP_Pop(&E->input_waypoint) : E->code->restart;
+		INST_JUMP(tmp);
 	}
 }
 
+// Version of `]` paired with its `[` on compile time, which jumps without using waypoints
+INSTR(inst_InputLoop) {
+	if (E->input_index < E->input_length)
+		INST_JUMP(E->code->ops[E->pc].jump);
+}
+
 // ({) c( -- waypoint ) Set the waypoint used in `}`, which checks the topmost item of the data
 INSTR(inst_SetDataWP) {
-	WP_Push(&E->data_waypoint, E->pc-1);
+	WP_Push(&E->data_waypoint, E->pc);
 }
 
-// (}) c,d( waypoint,top -- ) Return (set pc) to the last data waypoint if the topmost item of the stack isn't NUL (or if the stack isn't empty)
-INSTR(inst_UseDataWP) {
-	// Return if stack is empty
-	if (E->data.length == 0)
+void Inst_Release(func_t *F) {
+	if (--F->refs != 0)
 		return;
 
-	// Check top item on the stack
-	ditem_t top = E->data.items[E->data.length-1];
-	switch (E->data.mode) {
-		case EAST_DATA_CHAR:
-			if (top.c) {
-				pc_t tmp = WP_Pop(&E->data_waypoint);
-				E->pc = tmp;
-			}
-			break;
-		case EAST_DATA_FLOAT:
-			if (top.f) {
-				pc_t tmp = WP_Pop(&E->data_waypoint);
-				E->pc = tmp;
-			}
-			break;
-		case EAST_DATA_DOUBLE:
-			if (top.d) {
-				pc_t tmp = WP_Pop(&E->data_waypoint);
-				E->pc = tmp;
-			}
-			break;
-	}
+	Code_Delete(&F->code);
+	Pool_Free(F->pool, F->string, F->length+1);
+	Pool_Free(F->pool, F, sizeof(func_t));
 }
 
-// (?) d,c( top :2nd -- skip1 ) If the top two items on the data are equal, the next instruction is skipped, otherwise, it is executed. The last element of the data is always popped
-INSTR(inst_IfNotEqual) {
-	switch (E->data.mode) {
-		case EAST_DATA_CHAR: {
-				char a = Data_PopC(&E->data);
-				char b = E->data.items[E->data.length-1].c;
-
-				if (b == a) {
-					E->pc += 1;
-					if (!E->exec[E->pc]) {
-						E->pc -= 1;
-						INST_ERR("No instruction to skip to");
-					}
-				}
-				break;
-			}
-		case EAST_DATA_FLOAT: {
-				float a = Data_PopF(&E->data);
-				float b = E->data.items[E->data.length-1].f;
-
-				if (b == a) {
-					E->pc += 1;
-					if (!E->exec[E->pc]) {
-						E->pc -= 1;
-						INST_ERR("No instruction to skip to");
-					}
-				}
-				break;
-			}
-		case EAST_DATA_DOUBLE: {
-				float a = Data_PopF(&E->data);
-				float b = E->data.items[E->data.length-1].f;
-
-				if (b == a) {
-					E->pc += 1;
-					if (!E->exec[E->pc]) {
-						E->pc -= 1;
-						INST_ERR("No instruction to skip to");
-					}
-				}
-				break;
-			}
+void Inst_Call(East_State *E, func_t *F) {
+#ifdef EAST_PROFILE
+	pc_t caller = E->pc;
+#endif
+	// Nothing runs after a call that is the last instruction, so its frame can be reused (unless it belongs to an outer loop)
+	int tail = E->code->ops[E->pc+1].op == OP_END && E->frames_length >= E->frames_base;
+
+	// Before taking the reference, so an error leaves nothing to release
+	if (!tail) {
+		if (E->frames_length >= E->run->max_depth)
+			INST_ERR("Recursion limit reached (raise it with -r)");
+
+		if (E->frames_length == E->frames_size) {
+			size_t size = E->frames_size ? E->frames_size*2 : 16;
+			frame_t *tmp = realloc(E->frames, sizeof(frame_t)*size);
+			if (!tmp)
+				INST_ERR("Out of memory");
+
+			// New slots have no waypoints yet
+			memset(tmp + E->frames_size, 0, sizeof(frame_t)*(size - E->frames_size));
+			E->frames = tmp;
+			E->frames_size = size;
+		}
+	}
+
+	F->refs++;
+	E->run->calls++;
+
+	if (tail) {
+		if (E->func)
+			Inst_Release(E->func);
+		E->data_waypoint.length = 0;
+		E->run->tail_calls++;
+		E->input_waypoint.length = 0;
+	} else {
+		frame_t *S = &E->frames[E->frames_length++];
+		wp_t data_waypoint = S->data_waypoint;
+		wp_t input_waypoint = S->input_waypoint;
+
+		S->exec = E->exec;
+		S->exec_length = E->exec_length;
+		S->code = E->code;
+		S->pc = E->pc;
+		S->input_index = E->input_index;
+		S->data_waypoint = E->data_waypoint;
+		S->input_waypoint = E->input_waypoint;
+		S->func = E->func;
+
+		// Take the waypoints left on the slot by the last call, only new slots need them
+		if (!data_waypoint.items) {
+			data_waypoint = WP_Create();
+			input_waypoint = WP_Create();
+			E->run->wp_creates += 2;
+		}
+		E->data_waypoint = data_waypoint;
+		E->input_waypoint = input_waypoint;
+		E->data_waypoint.length = 0;
+		E->input_waypoint.length = 0;
 	}
+
+	E->exec = F->string;
+	E->exec_length = F->length;
+	E->code = &F->code;
+	E->func = F;
+	E->input_index = 0;
+	// Starts on 0 after the dispatch loop moves to the next instruction
+	E->pc = (pc_t)-1;
+
+#ifdef EAST_PROFILE
+	if (E->run->profile)
+		Prof_Call(E->run->profile, E, caller, tail);
+#endif
 }
 
-// (#) e( skip -> ) Ignores everything until a newline or a NUL is found on the executed string
-INSTR(inst_Comment) {
-	while (E->exec[E->pc] != '\n' && E->exec[E->pc] != '\0') {
-		E->pc++;
-	}
+void Inst_Return(East_State *E) {
+	if (E->func)
+		Inst_Release(E->func);
+
+	frame_t *S = &E->frames[--E->frames_length];
+	wp_t data_waypoint = E->data_waypoint;
+	wp_t input_waypoint = E->input_waypoint;
+
+	E->exec = S->exec;
+	E->exec_length = S->exec_length;
+	E->code = S->code;
+	E->pc = S->pc;
+	E->input_index = S->input_index;
+	E->data_waypoint = S->data_waypoint;
+	E->input_waypoint = S->input_waypoint;
+	E->func = S->func;
+
+	// Kept for the next call
+	S->data_waypoint = data_waypoint;
+	S->input_waypoint = input_waypoint;
+
+#ifdef EAST_PROFILE
+	if (E->run->profile)
+		Prof_Return(E->run->profile);
+#endif
+}
+
+// Compile a string taken from the pool of R (length+1 bytes), the result owns it and has a single reference
+static func_t *FuncCreate(run_t *R, char *string, size_t length, int name) {
+	func_t *F = Pool_Alloc(&R->pool, sizeof(func_t));
+
+	F->string = string;
+	F->length = length;
+	F->code = Code_Compile(string, length, R->optimize);
+	F->refs = 1;
+	F->pool = &R->pool;
+	F->name = name;
+
+	return F;
 }
 
 // (%) c( until_end -> ) Declare a user defined instruction, for later access with `$`, the function declaration is from the % (taking the next character as the name) to the corresponding '^'
 INSTR(inst_FuncDec) {
-	// Allocate a string to define the function
-	size_t size = 10;
-	size_t length = 0;
-	char *func = malloc(size*sizeof(char));
+	// The compiler already checked for the '^' and knows where it is
+	pc_t start = E->code->ops[E->pc].pos+1;
+	pc_t end = E->code->ops[E->pc].jump;
+
+	// An empty declaration (`%^`) is named NUL
+	unsigned char name = (start < end) ? E->exec[start] : '\0';
+	const char *body = E->exec + start + 1;
+	size_t length = (start < end) ? end - start - 1 : 0;
+
+	// Declarations inside loops run many times, only compile again if the body changed
+	func_t *old = E->userinstr[name];
+	if (old && old->length == length && memcmp(old->string, body, length) == 0)
+		return;
 
-	pc_t cur = E->pc+1;
+	// Owned copy, the code it came from may be freed before the instruction is called
+	char *string = Pool_Alloc(&E->run->pool, length+1);
+	memcpy(string, body, length);
+	string[length] = '\0';
 
-	while (1) {
-		if (E->exec[cur] == '\0')
-			INST_ERR("Expected '^' on function definition, got EOF");
+	E->userinstr[name] = FuncCreate(E->run, string, length, name);
+	if (old)
+		Inst_Release(old);
+}
 
-		// Resize if required
-		if (length+1 > size) {
-			size *= 2;
-			char *tmp = realloc(func, size*sizeof(char));
-			if (!tmp)
-				INST_ERR("Out of memory");
-			func = tmp;
-		}
+// ($) c( user_defined -- user_defined ) Execute user defined function, the next character is used as the name of it
+INSTR(inst_FuncExec) {
+	func_t *F = E->userinstr[(unsigned char)INST_ARG];
 
-		if (E->exec[cur] == '^') {
-			func[length] = '\0';
-			break;
-		} else {
-			func[length] = E->exec[cur];
-		}
+	// Undeclared instructions do nothing
+	if (!F)
+		return;
 
-		length++;
-		cur++;
+	Inst_Call(E, F);
+}
+
+// Compiler generated instructions
+
+// Continue on another place of the compiled code
+INSTR(inst_Jump) {
+	INST_JUMP(E->code->ops[E->pc].jump);
+}
+
+// Report an error found while compiling
+INSTR(inst_Error) {
+	INST_ERR(Code_Errors[(size_t)INST_ARG]);
+}
+
+// Fused `[.>]`, push the rest of the input
+INSTR(inst_PushInput) {
+	// Like `.`, an ended input gives a single NUL
+	if (E->input_index >= E->input_length) {
+		Data_PushString(&E->data, "", 1);
+		return;
 	}
-	E->userinstr[(size_t)*func] = func+1;
-	free(func);
 
-	E->pc = cur;
+	Data_PushString(&E->data, E->input + E->input_index, E->input_length - E->input_index);
+	E->input_index = E->input_length;
 }
 
-// ($) c( user_defined -- user_defined ) Execute user defined function, the next character is used as the name of it
-INSTR(inst_FuncExec) {
-	if (E->exec[E->pc+1] == '\0')
-		INST_ERR("Tried to call EOF as an user defined instruction");
-	E->pc++;
+// Fused `[.;>]`, print the rest of the input
+INSTR(inst_CatInput) {
+	if (E->input_index >= E->input_length) {
+		OUT_CHAR(&E->run->out, '\0');
+		return;
+	}
 
-	ExecuteString(E->userinstr[(size_t)E->exec[E->pc]], &E->data, E->instr, &E->userinstr, E->input);
+	Out_Write(&E->run->out, E->input + E->input_index, E->input_length - E->input_index);
+	E->input_index = E->input_length;
 }
 
+// Fused `!@!`, rotate the data the other way
+INSTR(inst_RotateBack) {
+	Data_Reverse(&E->data);
+	Data_Rotate(&E->data);
+	Data_Reverse(&E->data);
+}
+
+// Every name a char can have, all undeclared
 uinst_t *Inst_UCreate() {
-	static uinst_t i[127];
+	uinst_t *U = calloc(EAST_UINST_COUNT, sizeof(uinst_t));
+	if (!U)
+		UINST_ERR("Out of memory");
 
-	for (int c = 0; c < 127; c++)
-		i[c] = "";
+	return U;
+}
 
-	return i;
+void Inst_UClear(uinst_t *U) {
+	for (size_t i = 0; i < EAST_UINST_COUNT; i++) {
+		if (U[i])
+			Inst_Release(U[i]);
+		U[i] = NULL;
+	}
 }
 
-inst_t *Inst_Get() {
-	static inst_t i[127];
-
-	// Uses executed string
-	for (int c = 0; c < 127; c++)
-		i[c] = inst_PushLiteral;
-
-	i['\\'] = inst_PushEscaped;
-
-	// Uses input string
-	i['<']  = inst_PrevChar;
-	i['>']  = inst_NextChar;
-	// Uses on top data item
-	i['.']  = inst_PushItem;
-	i[',']  = inst_PopItem;
-	i['&']  = inst_DupItem;
-	i[';']  = inst_PrintChar;
-	i[':']  = inst_PrintNumber;
-	// Uses topmost two stack items
-	i['+']  = inst_AddData;
-	i['-']  = inst_SubData;
-	i['*']  = inst_MultData;
-	i['/']  = inst_DivData;
-	// Uses entire stack
-	i['!']  = inst_ReverseData;
-	i['@']  = inst_RotateData;
-	// Uses until NUL
-	i['=']  = inst_ExecData;
-	// Uses PC, controls the state of the interpreter
-	i['[']  = inst_SetInputWP;
-	i[']']  = inst_UseInputWP;
-	i['{']  = inst_SetDataWP;
-	i['}']  = inst_UseDataWP;
-	i['?']  = inst_IfNotEqual;
-	i['#']  = inst_Comment;
-	// Functions
-	i['%']  = inst_FuncDec;
-	i['$']  = inst_FuncExec;
-
-	return i;
+void Inst_UDelete(uinst_t *U) {
+	Inst_UClear(U);
+	free(U);
+}
+
+void Inst_CacheDelete(run_t *R) {
+	for (size_t i = 0; i < EAST_EXEC_CACHE_SIZE; i++) {
+		if (R->exec_cache[i])
+			Inst_Release(R->exec_cache[i]);
+		R->exec_cache[i] = NULL;
+	}
+}
+
+// Hash of the strings on the `=` cache (FNV-1a), fed one char at a time
+#define EXEC_HASH_INIT ((size_t)2166136261u)
+#define EXEC_HASH(h, c) (((h) ^ (unsigned char)(c)) * (size_t)16777619u)
+
+// Instructions for each mode
+#define MODE_S C
+#define MODE_T char
+#define MODE_W int
+#define MODE_PRINT(O, n) Out_Format(O, "%i", (signed char)(n))
+#include "instmode.h"
+
+#define MODE_S F
+#define MODE_T float
+#define MODE_W float
+#define MODE_PRINT(O, n) Out_Format(O, "%f", (n))
+#include "instmode.h"
+
+// Print in scientific notation if it is bigger than one million, normal float like otherwise
+#define MODE_S D
+#define MODE_T double
+#define MODE_W double
+#define MODE_PRINT(O, n) do { double tmp = (n); Out_Format(O, (tmp > 1e6) ? "%e" : "%f", tmp); } while (0)
+#include "instmode.h"
+
+#define MODE_S I
+#define MODE_T int32_t
+#define MODE_W uint32_t
+#define MODE_PRINT(O, n) Out_Format(O, "%li", (long)(n))
+#include "instmode.h"
+
+#define MODE_S L
+#define MODE_T int64_t
+#define MODE_W uint64_t
+#define MODE_PRINT(O, n) Out_Format(O, "%lli", (long long)(n))
+#include "instmode.h"
+
+const inst_t *Inst_Get(dmode_t mode) {
+	switch (mode) {
+		case EAST_DATA_FLOAT:
+			return Inst_TableF;
+		case EAST_DATA_DOUBLE:
+			return Inst_TableD;
+		case EAST_DATA_INT:
+			return Inst_TableI;
+		case EAST_DATA_LONG:
+			return Inst_TableL;
+		case EAST_DATA_CHAR:
+		default:
+			return Inst_TableC;
+	}
 }
@@ -20,50 +20,22 @@
 #define EAST_INSTR_H
 
 #include "globals.h"
-#define INST_ERR(err) do {fprintf(stderr, "East, error while interpreting\nCharacter %zu ('%c'): %s\n", E->pc+1, E->exec[E->pc], err); exit(1);} while (0);
-
-// Generic macro for doing math operations, handles modes correctly
-#define INST_MATH_OP(op) \
-	switch (E->data.mode) { \
-		case EAST_DATA_CHAR: { \
-				if (E->data.length == 0) INST_ERR("Data empty"); \
-				char a = Data_PopC(&E->data); \
-				if (E->data.length == 0) INST_ERR("Data empty"); \
-				char b = Data_PopC(&E->data); \
-				Data_PushC(&E->data,op); \
-				break; \
-			} \
-		case EAST_DATA_FLOAT: { \
-				if (E->data.length == 0) INST_ERR("Data empty"); \
-				float a = Data_PopF(&E->data); \
-				if (E->data.length == 0) INST_ERR("Data empty"); \
-				float b = Data_PopF(&E->data); \
-				Data_PushF(&E->data,op); \
-				break; \
-			} \
-		case EAST_DATA_DOUBLE: { \
-				if (E->data.length == 0) INST_ERR("Data empty"); \
-				float a = Data_PopD(&E->data); \
-				if (E->data.length == 0) INST_ERR("Data empty"); \
-				float b = Data_PopD(&E->data); \
-				Data_PushD(&E->data,op); \
-				break; \
-			} \
-	}
-
-// Push a character to the stack, no matter which one is the mode
-#define INST_PUSH_CASTED(character) \
-	switch (E->data.mode) { \
-		case EAST_DATA_CHAR: \
-			Data_PushC(&E->data, character); \
-			break; \
-		case EAST_DATA_FLOAT: \
-			Data_PushF(&E->data, character); \
-			break; \
-		case EAST_DATA_DOUBLE: \
-			Data_PushD(&E->data, character); \
-			break; \
-	}
+#include "profile.h"
+#include "simd.h"
+
+#define INST_ERR(err) do {Error_Raise(err, E->code->ops[E->pc].pos+1, E->exec[E->code->ops[E->pc].pos]);} while (0);
+
+// Errors outside of an instruction
+#define UINST_ERR(msg) Error_Raise(msg, 0, 0)
+
+// Argument of the current instruction (literal or name)
+#define INST_ARG (E->code->ops[E->pc].arg)
+
+// Continue execution on the given instruction, pc gets incremented after every instruction
+#define INST_JUMP(target) (E->pc = (target) - 1)
+
+// Instructions that depend on the type of the items have a version for each mode, named with the suffix of the mode
+#define INSTR_MODES(name) INSTR(name##C); INSTR(name##F); INSTR(name##D); INSTR(name##I); INSTR(name##L)
 
 // Input string operations (read only)
 
@@ -75,32 +47,32 @@ INSTR(inst_PrevChar);
 
 // Generic data operations
 
-// (.) i->d( in -- char ) Push the current input character to the data
-INSTR(inst_PushItem);
+// (.) i->d( in -- char ) Push the current input character to the data, NUL if the input ended
+INSTR_MODES(inst_PushItem);
 
 // (,) d( top -- ) Pop the topmost item from the data
 INSTR(inst_PopItem);
 
 // (&) d( top -- copy copy ) Duplicate the topmost item from the data
-INSTR(inst_DupItem);
+INSTR_MODES(inst_DupItem);
 
 // (;) d->i( top -- char ) Pop and print the topmost character from the data
-INSTR(inst_PrintChar);
+INSTR_MODES(inst_PrintChar);
 
 // (:) d->i( top -- number ) Pop and print the topmost character from the data as a number
-INSTR(inst_PrintNumber);
+INSTR_MODES(inst_PrintNumber);
 
 // (+) d( item1 item2 -- result ) Add the two topmost items of the data
-INSTR(inst_AddData);
+INSTR_MODES(inst_AddData);
 
 // (-) d( item1 item2 -- result ) Substract the two topmost items of the data
-INSTR(inst_SubData);
+INSTR_MODES(inst_SubData);
 
 // (*) d( item1 item2 -- result ) Multiply the two topmost items of the data
-INSTR(inst_MultData);
+INSTR_MODES(inst_MultData);
 
 // (/) d( item1 item2 -- result ) Divide the two topmost items of the data, if the top one is 0, then it gets replaced with 1 to prevent "division by zero" errors
-INSTR(inst_DivData);
+INSTR_MODES(inst_DivData);
 
 // (!) d( everything -> reversed ) Reverse the entire data, for example, 'a' 'b' 'c' -> 'c' 'b' 'a'
 INSTR(inst_ReverseData);
@@ -109,33 +81,39 @@ INSTR(inst_ReverseData);
 INSTR(inst_RotateData);
 
 // (=) d( until_NUL -- execute_result ) Read (not pop) everything until a NUL, reverse it, and execute it as East code, only being able to modify the data (the rest is isolated)
-INSTR(inst_ExecData);
+INSTR_MODES(inst_ExecData);
 
 // ([a-z0-9]) e->d( char -- item ) Push the current character on the executed string
-INSTR(inst_PushLiteral);
+INSTR_MODES(inst_PushLiteral);
 
 // (\) e->d( char -- escaped_item ) Push the following character escaped, based on the hardcoded "escaped" array
-INSTR(inst_PushEscaped);
+// Escaped characters are resolved when compiling and pushed with inst_PushLiteral
 
 // Control statements (The ones that modify the interpreter state)
 
 // ([) c( -- waypoint ) Set the waypoint used in `]`, which checks the input character
 INSTR(inst_SetInputWP);
 
-// (]) c,i( waypoint,current -- ) Return (set pc) to the last input waypoint if the current character on the input string is not NUL
+// (]) c,i( waypoint,current -- ) Return (set pc) to the last input waypoint if the end of the input string hasn't been reached
 INSTR(inst_UseInputWP);
 
+// Version of `]` paired with its `[` on compile time, which jumps without using waypoints
+INSTR(inst_InputLoop);
+
 // ({) c( -- waypoint ) Set the waypoint used in `}`, which checks the topmost item of the data
 INSTR(inst_SetDataWP);
 
 // (}) c,d( waypoint,top -- ) Return (set pc) to the last data waypoint if the topmost item of the stack isn't NUL (or if the stack isn't empty)
-INSTR(inst_UseDataWP);
+INSTR_MODES(inst_UseDataWP);
+
+// Version of `}` paired with its `{` on compile time, which jumps without using waypoints
+INSTR_MODES(inst_DataLoop);
 
 // (?) d,c( top :2nd -- skip1 ) If the top two items on the data are equal, the next instruction is skipped, otherwise, it is executed. The last element of the data is always popped
-INSTR(inst_IfNotEqual);
+INSTR_MODES(inst_IfNotEqual);
 
 // (#) e( skip -> ) Ignores everything until a newline or a NUL is found on the executed string
-INSTR(inst_Comment);
+// Comments are removed when compiling, unless a `?` makes them executable
 
 // (%) c( until_end -> ) Declare a user defined instruction, for later access with `$`, the function declaration is from the % (taking the next character as the name) to the corresponding '^'
 INSTR(inst_FuncDec);
@@ -143,7 +121,54 @@ INSTR(inst_FuncDec);
 // ($) c( user_defined -- user_defined ) Execute user defined function, the next character is used as the name of it
 INSTR(inst_FuncExec);
 
+// Segment operations (on the items above the topmost NUL, or the whole data if there is none)
+
+// (|+ |- |* |/) d( segment top -- segment ) Pop the top item and apply the math operation between each item of the segment and it, as in item+top for `|+`
+INSTR_MODES(inst_SegMap);
+
+// (|s |< |> |c) d( segment -- result ) Replace the segment with its sum, minimum, maximum or count, 0 if it is empty
+INSTR_MODES(inst_SegReduce);
+
+// (|f |a) d,i( char/segment -- found ) Pop the top item (`|f`) or the segment (`|a`) and go to the next character of the input that is one of them, starting from the current one, push 1 if there was one and 0 (at the end of the input) otherwise
+INSTR_MODES(inst_Scan);
+
+// Compiler generated instructions
+
+// Continue on another place of the compiled code
+INSTR(inst_Jump);
+
+// Report an error found while compiling
+INSTR(inst_Error);
+
+// Fused `[.>]`, push the rest of the input
+INSTR(inst_PushInput);
+
+// Fused `[.;>]`, print the rest of the input
+INSTR(inst_CatInput);
+
+// Fused `{;}`, print the data until a NUL
+INSTR_MODES(inst_PrintData);
+
+// Fused `!@!`, rotate the data the other way
+INSTR(inst_RotateBack);
+
+// Fused literal and `+`, add the literal to the topmost item
+INSTR_MODES(inst_AddConst);
+
+// Switch to the code of F (used by `=` and `$`), the dispatch loop goes back to the caller with Inst_Return on its OP_END
+void Inst_Call(East_State *E, func_t *F);
+void Inst_Return(East_State *E);
+// Drop a reference to F, freeing it when it was the last one
+void Inst_Release(func_t *F);
+
+// Table of user defined instructions, owned by the caller
 uinst_t *Inst_UCreate();
-inst_t *Inst_Get();
+void Inst_UDelete(uinst_t *U);
+// Undeclare everything, keeping the table
+void Inst_UClear(uinst_t *U);
+// Free the compiled code cached by `=`
+void Inst_CacheDelete(run_t *R);
+// Instruction table of the given mode, indexed by opcode
+const inst_t *Inst_Get(dmode_t mode);
 
 #endif // EAST_INSTR_H header guard
@@ -0,0 +1,616 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+// mmap, mprotect and MAP_ANONYMOUS
+#define _DEFAULT_SOURCE
+
+#include "jit.h"
+#include "engine.h"
+
+#ifdef EAST_JIT
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#define JIT_ERR(msg) Error_Raise(msg, 0, 0)
+
+// Registers that hold the state while running, all of them callee saved
+//  rbx: East_State
+//  r12: data items
+//  r13: data length
+//  r14: data head
+//  r15: data mask (size-1)
+//  rbp: input index
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+// Condition codes for jcc
+enum { CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_BE = 0x6, CC_A = 0x7 };
+
+// Offsets of the state used by the native code
+#define OFF_PC          offsetof(East_State, pc)
+#define OFF_INPUT       offsetof(East_State, input)
+#define OFF_INPUT_LEN   offsetof(East_State, input_length)
+#define OFF_INPUT_INDEX offsetof(East_State, input_index)
+#define OFF_RUN         offsetof(East_State, run)
+#define OFF_ITEMS       (offsetof(East_State, data) + offsetof(data_t, items))
+#define OFF_HEAD        (offsetof(East_State, data) + offsetof(data_t, head))
+#define OFF_LENGTH      (offsetof(East_State, data) + offsetof(data_t, length))
+#define OFF_SIZE        (offsetof(East_State, data) + offsetof(data_t, size))
+#define OFF_REVERSED    (offsetof(East_State, data) + offsetof(data_t, reversed))
+#define OFF_OUT_BUFFER  (offsetof(run_t, out) + offsetof(out_t, buffer))
+#define OFF_OUT_LENGTH  (offsetof(run_t, out) + offsetof(out_t, length))
+#define OFF_OUT_SIZE    (offsetof(run_t, out) + offsetof(out_t, size))
+#define OFF_OUT_FLUSH   (offsetof(run_t, out) + offsetof(out_t, line_flush))
+
+// Jump to an instruction that isn't emitted yet
+typedef struct {
+	size_t at;
+	pc_t target;
+} fixup_t;
+
+// State used only while compiling
+typedef struct {
+	East_State *E;
+	unsigned char *code;
+	size_t length;
+	size_t size;
+	// Where the native code of every instruction starts
+	size_t *native;
+	fixup_t *fixups;
+	size_t fixups_length;
+	size_t fixups_size;
+	// Absolute address of every instruction, for jumps only known while running (the ones from the waypoints)
+	void **addresses;
+} jit_t;
+
+// Append bytes, doubling the size of the code if necessary
+static void JitBytes(jit_t *J, const unsigned char *bytes, size_t n) {
+	while (J->length + n > J->size) {
+		J->size *= 2;
+
+		unsigned char *tmp = realloc(J->code, J->size);
+
+		if (!tmp)
+			JIT_ERR("Out of memory");
+
+		J->code = tmp;
+	}
+
+	memcpy(J->code + J->length, bytes, n);
+	J->length += n;
+}
+
+#define EMIT(...) do { \
+	const unsigned char emit_bytes[] = { __VA_ARGS__ }; \
+	JitBytes(J, emit_bytes, sizeof(emit_bytes)); \
+} while (0)
+
+static void JitU32(jit_t *J, uint32_t n) {
+	EMIT(n, n >> 8, n >> 16, n >> 24);
+}
+
+static void JitU64(jit_t *J, uint64_t n) {
+	JitU32(J, n);
+	JitU32(J, n >> 32);
+}
+
+// op reg, [base+disp32] with a 64 bit operand, the opcode is the byte after REX.W
+static void JitMem(jit_t *J, unsigned char opcode, int reg, int base, size_t disp) {
+	EMIT(0x48 | ((reg >> 3) << 2) | (base >> 3), opcode, 0x80 | ((reg & 7) << 3) | (base & 7));
+
+	// rsp and r12 as a base need a SIB byte
+	if ((base & 7) == RSP)
+		EMIT(0x24);
+
+	JitU32(J, disp);
+}
+
+#define LOAD64(reg, base, disp)  JitMem(J, 0x8B, reg, base, disp)
+#define STORE64(base, disp, reg) JitMem(J, 0x89, reg, base, disp)
+#define CMP64(reg, base, disp)   JitMem(J, 0x3B, reg, base, disp)
+
+// Jumps with a 32 bit displacement, return where the displacement is so it can be patched
+static size_t JitJcc(jit_t *J, int cc) {
+	EMIT(0x0F, 0x80 | cc);
+	JitU32(J, 0);
+	return J->length - 4;
+}
+
+static size_t JitJmp(jit_t *J) {
+	EMIT(0xE9);
+	JitU32(J, 0);
+	return J->length - 4;
+}
+
+// Make the jump whose displacement is at the given position land here
+static void JitLand(jit_t *J, size_t at) {
+	uint32_t rel = J->length - (at + 4);
+	memcpy(J->code + at, &rel, 4);
+}
+
+// Make the jump whose displacement is at the given position land on the instruction k
+static void JitFixup(jit_t *J, size_t at, pc_t k) {
+	if (J->fixups_length+1 > J->fixups_size) {
+		J->fixups_size *= 2;
+
+		fixup_t *tmp = realloc(J->fixups, sizeof(fixup_t)*J->fixups_size);
+
+		if (!tmp)
+			JIT_ERR("Out of memory");
+
+		J->fixups = tmp;
+	}
+
+	J->fixups[J->fixups_length++] = (fixup_t){ .at = at, .target = k };
+}
+
+// Write the registers back to E, for the handlers
+static void JitSync(jit_t *J) {
+	STORE64(RBX, OFF_INPUT_INDEX, RBP);
+	STORE64(RBX, OFF_LENGTH, R13);
+	STORE64(RBX, OFF_HEAD, R14);
+}
+
+// Read them again, the data may have been reallocated
+static void JitLoad(jit_t *J) {
+	LOAD64(RBP, RBX, OFF_INPUT_INDEX);
+	LOAD64(R12, RBX, OFF_ITEMS);
+	LOAD64(R13, RBX, OFF_LENGTH);
+	LOAD64(R14, RBX, OFF_HEAD);
+	LOAD64(R15, RBX, OFF_SIZE);
+	// dec r15
+	EMIT(0x49, 0xFF, 0xCF);
+}
+
+// Run a handler for the instruction k
+static void JitCallHandler(jit_t *J, pc_t k, inst_t handler) {
+	JitSync(J);
+
+	// mov qword [rbx+pc], k
+	EMIT(0x48, 0xC7, 0x83);
+	JitU32(J, OFF_PC);
+	JitU32(J, k);
+
+	// mov rdi, rbx; mov rax, handler; call rax
+	EMIT(0x48, 0x89, 0xDF, 0x48, 0xB8);
+	JitU64(J, (uintptr_t)handler);
+	EMIT(0xFF, 0xD0);
+
+	JitLoad(J);
+}
+
+// Run the handler of the instruction k from the table, like the interpreter does
+static void JitCall(jit_t *J, pc_t k) {
+	JitCallHandler(J, k, J->E->instr[J->E->code->ops[k].op]);
+}
+
+// After calling the handler of k, go where it jumped to, if it did (INST_JUMP leaves pc on the instruction before)
+static void JitFollow(jit_t *J, pc_t k) {
+	// cmp qword [rbx+pc], k
+	EMIT(0x48, 0x81, 0xBB);
+	JitU32(J, OFF_PC);
+	JitU32(J, k);
+
+	JitFixup(J, JitJcc(J, CC_NE), J->E->code->ops[k].jump);
+}
+
+// Same, but the target is only known while running
+static void JitFollowDynamic(jit_t *J, pc_t k) {
+	EMIT(0x48, 0x81, 0xBB);
+	JitU32(J, OFF_PC);
+	JitU32(J, k);
+	size_t same = JitJcc(J, CC_E);
+
+	// mov rax, [rbx+pc]; inc rax; mov rcx, addresses; jmp [rcx+rax*8]
+	LOAD64(RAX, RBX, OFF_PC);
+	EMIT(0x48, 0xFF, 0xC0, 0x48, 0xB9);
+	JitU64(J, (uintptr_t)J->addresses);
+	EMIT(0xFF, 0x24, 0xC1);
+
+	JitLand(J, same);
+}
+
+// Slot of the topmost item on rax and of the second one on rcx, only valid if not reversed
+static void JitTop(jit_t *J) {
+	// lea rax, [r14+r13-1]; and rax, r15
+	EMIT(0x4B, 0x8D, 0x44, 0x2E, 0xFF, 0x4C, 0x21, 0xF8);
+}
+
+static void JitSecond(jit_t *J) {
+	// lea rcx, [r14+r13-2]; and rcx, r15
+	EMIT(0x4B, 0x8D, 0x4C, 0x2E, 0xFE, 0x4C, 0x21, 0xF9);
+}
+
+// Slot after the topmost item on rax
+static void JitNext(jit_t *J) {
+	// lea rax, [r14+r13]; and rax, r15
+	EMIT(0x4B, 0x8D, 0x04, 0x2E, 0x4C, 0x21, 0xF8);
+}
+
+// Jump to slow when the data is reversed, the native code only handles the usual direction
+static size_t JitIfReversed(jit_t *J) {
+	// cmp dword [rbx+reversed], 0
+	EMIT(0x83, 0xBB);
+	JitU32(J, OFF_REVERSED);
+	EMIT(0x00);
+	return JitJcc(J, CC_NE);
+}
+
+// Jump to slow when there are less than n items
+static size_t JitIfLess(jit_t *J, int n) {
+	// cmp r13, n
+	EMIT(0x49, 0x83, 0xFD, n);
+	return JitJcc(J, CC_B);
+}
+
+// Jump to slow when there is no space for another item
+static size_t JitIfFull(jit_t *J) {
+	// cmp r13, r15
+	EMIT(0x4D, 0x39, 0xFD);
+	return JitJcc(J, CC_A);
+}
+
+// op reg, [r12+index*2^scale] with a one or two byte (0x0F first) opcode, wide adds REX.W
+static void JitItem(jit_t *J, int wide, unsigned opcode, int reg, int index, int scale) {
+	EMIT(0x41 | (wide ? 0x08 : 0));
+
+	if (opcode > 0xFF)
+		EMIT(opcode >> 8);
+
+	EMIT(opcode, ((reg & 7) << 3) | 0x04, (scale << 6) | (index << 3) | 0x04);
+}
+
+// Integer mode instructions that have native code, on items of 1 (char), 4 (int) or 8 (long) bytes, the handler is only called for the rare cases (errors, reversed data or growing it)
+static int JitInteger(jit_t *J, pc_t k, int w) {
+	op_t *op = J->E->code->ops + k;
+	size_t slow[4];
+	int n = 0;
+	// Unchecked instructions are the same without the check for items
+	unsigned char code = Code_Checked(op->op);
+	int safe = code != op->op;
+	// Operand size, scale of the index and opcodes for the width, chars are zero extended when loaded
+	int wide = w == 8;
+	int scale = w == 1 ? 0 : w == 4 ? 2 : 3;
+	int byte = w == 1;
+	unsigned load = byte ? 0x0FB6 : 0x8B;
+	unsigned store = byte ? 0x88 : 0x89;
+
+	switch (code) {
+		case OP_PUSH:
+		case OP_PUSHITEM:
+			slow[n++] = JitIfReversed(J);
+			slow[n++] = JitIfFull(J);
+
+			if (op->op == OP_PUSH) {
+				// mov [r12+rax*w], arg (sign extended, like the cast from char)
+				JitNext(J);
+				JitItem(J, wide, byte ? 0xC6 : 0xC7, 0, RAX, scale);
+
+				if (byte)
+					EMIT(op->arg);
+				else
+					JitU32(J, (uint32_t)(int32_t)op->arg);
+			} else {
+				// xor edx, edx; mov rcx, [rbx+input_length]; cmp rbp, rcx; jae ended
+				EMIT(0x31, 0xD2);
+				LOAD64(RCX, RBX, OFF_INPUT_LEN);
+				EMIT(0x48, 0x39, 0xCD);
+				size_t ended = JitJcc(J, CC_AE);
+				// mov rcx, [rbx+input]; movzx edx, byte [rcx+rbp] (movsx rdx for the wider items, the input is char)
+				LOAD64(RCX, RBX, OFF_INPUT);
+				if (byte)
+					EMIT(0x0F, 0xB6, 0x14, 0x29);
+				else
+					EMIT(0x48, 0x0F, 0xBE, 0x14, 0x29);
+				JitLand(J, ended);
+				// mov [r12+rax*w], rdx
+				JitNext(J);
+				JitItem(J, wide, store, RDX, RAX, scale);
+			}
+
+			// inc r13
+			EMIT(0x49, 0xFF, 0xC5);
+			break;
+		case OP_POPITEM:
+			slow[n++] = JitIfReversed(J);
+			if (!safe)
+				slow[n++] = JitIfLess(J, 1);
+			// dec r13
+			EMIT(0x49, 0xFF, 0xCD);
+			break;
+		case OP_DUPITEM:
+			slow[n++] = JitIfReversed(J);
+			if (!safe)
+				slow[n++] = JitIfLess(J, 1);
+			slow[n++] = JitIfFull(J);
+			// mov rdx, [r12+rax*w]; mov [r12+rax*w], rdx; inc r13
+			JitTop(J);
+			JitItem(J, wide, load, RDX, RAX, scale);
+			JitNext(J);
+			JitItem(J, wide, store, RDX, RAX, scale);
+			EMIT(0x49, 0xFF, 0xC5);
+			break;
+		case OP_ADD:
+		case OP_SUB:
+		case OP_MULT:
+			slow[n++] = JitIfReversed(J);
+			if (!safe)
+				slow[n++] = JitIfLess(J, 2);
+			JitTop(J);
+			JitSecond(J);
+			// mov rdx, [r12+rax*w]
+			JitItem(J, wide, load, RDX, RAX, scale);
+
+			if (code == OP_ADD) {
+				// add [r12+rcx*w], rdx
+				JitItem(J, wide, byte ? 0x00 : 0x01, RDX, RCX, scale);
+			} else if (code == OP_SUB) {
+				// sub [r12+rcx*w], rdx
+				JitItem(J, wide, byte ? 0x28 : 0x29, RDX, RCX, scale);
+			} else {
+				// mov rax, [r12+rcx*w]; imul rax, rdx; mov [r12+rcx*w], rax (the low bits wrap like the unsigned math)
+				JitItem(J, wide, load, RAX, RCX, scale);
+				if (wide)
+					EMIT(0x48);
+				EMIT(0x0F, 0xAF, 0xC2);
+				JitItem(J, wide, store, RAX, RCX, scale);
+			}
+
+			// dec r13
+			EMIT(0x49, 0xFF, 0xCD);
+			break;
+		case OP_ADDCONST:
+			slow[n++] = JitIfReversed(J);
+			if (!safe)
+				slow[n++] = JitIfLess(J, 1);
+			// add [r12+rax*w], arg (sign extended)
+			JitTop(J);
+			JitItem(J, wide, byte ? 0x80 : 0x83, 0, RAX, scale);
+			EMIT(op->arg);
+			break;
+		case OP_PRINTCHAR:
+			slow[n++] = JitIfReversed(J);
+			if (!safe)
+				slow[n++] = JitIfLess(J, 1);
+			// mov rsi, [rbx+run]; mov rdx, [rsi+out.length]; cmp rdx, [rsi+out.size]; jae slow
+			LOAD64(RSI, RBX, OFF_RUN);
+			LOAD64(RDX, RSI, OFF_OUT_LENGTH);
+			CMP64(RDX, RSI, OFF_OUT_SIZE);
+			slow[n++] = JitJcc(J, CC_AE);
+			// cmp dword [rsi+out.line_flush], 0; jne slow
+			EMIT(0x83, 0xBE);
+			JitU32(J, OFF_OUT_FLUSH);
+			EMIT(0x00);
+			slow[n++] = JitJcc(J, CC_NE);
+			// movzx eax, byte [r12+rax*w] (the lowest byte, as in the cast to char); mov rcx, [rsi+out.buffer]; mov [rcx+rdx], al; inc rdx
+			JitTop(J);
+			JitItem(J, 0, 0x0FB6, RAX, RAX, scale);
+			LOAD64(RCX, RSI, OFF_OUT_BUFFER);
+			EMIT(0x88, 0x04, 0x11, 0x48, 0xFF, 0xC2);
+			// mov [rsi+out.length], rdx; dec r13
+			STORE64(RSI, OFF_OUT_LENGTH, RDX);
+			EMIT(0x49, 0xFF, 0xCD);
+			break;
+		case OP_DATALOOP:
+			slow[n++] = JitIfReversed(J);
+			// test r13, r13; jz next
+			EMIT(0x4D, 0x85, 0xED);
+			size_t empty = JitJcc(J, CC_E);
+			// cmp [r12+rax*w], 0; jne body
+			JitTop(J);
+			JitItem(J, wide, byte ? 0x80 : 0x83, 7, RAX, scale);
+			EMIT(0x00);
+			JitFixup(J, JitJcc(J, CC_NE), op->jump);
+			JitLand(J, empty);
+			break;
+		case OP_IFNOTEQUAL:
+			slow[n++] = JitIfReversed(J);
+			slow[n++] = JitIfLess(J, 2);
+			// dec r13 first, the top item stays where it was
+			JitTop(J);
+			JitSecond(J);
+			EMIT(0x49, 0xFF, 0xCD);
+			// mov rdx, [r12+rax*w]; cmp [r12+rcx*w], rdx; je skip
+			JitItem(J, wide, load, RDX, RAX, scale);
+			JitItem(J, wide, byte ? 0x38 : 0x39, RDX, RCX, scale);
+			JitFixup(J, JitJcc(J, CC_E), op->jump);
+			break;
+		default:
+			return 0;
+	}
+
+	size_t done = JitJmp(J);
+
+	for (int i = 0; i < n; i++)
+		JitLand(J, slow[i]);
+
+	JitCall(J, k);
+
+	if (op->op == OP_DATALOOP || op->op == OP_IFNOTEQUAL)
+		JitFollow(J, k);
+
+	JitLand(J, done);
+	return 1;
+}
+
+// Native code of the instruction k
+static void JitInstruction(jit_t *J, pc_t k) {
+	op_t *op = J->E->code->ops + k;
+
+	// Size of the items in the integer modes, the floating point ones always call the handlers
+	static const int widths[EAST_DATA_MODES] = {
+		[EAST_DATA_CHAR] = 1,
+		[EAST_DATA_INT] = 4,
+		[EAST_DATA_LONG] = 8
+	};
+	int w = widths[J->E->data.mode];
+
+	if (w && JitInteger(J, k, w))
+		return;
+
+	switch (op->op) {
+		case OP_NEXTCHAR: {
+				// cmp rbp, [rbx+input_length]; jae end; inc rbp
+				CMP64(RBP, RBX, OFF_INPUT_LEN);
+				size_t end = JitJcc(J, CC_AE);
+				EMIT(0x48, 0xFF, 0xC5);
+				JitLand(J, end);
+				break;
+			}
+		case OP_PREVCHAR: {
+				// test rbp, rbp; jz end; dec rbp
+				EMIT(0x48, 0x85, 0xED);
+				size_t end = JitJcc(J, CC_E);
+				EMIT(0x48, 0xFF, 0xCD);
+				JitLand(J, end);
+				break;
+			}
+		case OP_INPUTLOOP:
+			// cmp rbp, [rbx+input_length]; jb body
+			CMP64(RBP, RBX, OFF_INPUT_LEN);
+			JitFixup(J, JitJcc(J, CC_B), op->jump);
+			break;
+		case OP_JUMP:
+			JitFixup(J, JitJmp(J), op->jump);
+			break;
+		case OP_NOP:
+			break;
+		case OP_END:
+			// Write the state back, restore the registers and return
+			JitSync(J);
+			EMIT(0x48, 0x83, 0xC4, 0x08, 0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5D, 0x5B, 0xC3);
+			break;
+		case OP_DATALOOP:
+		case OP_IFNOTEQUAL:
+			JitCall(J, k);
+			JitFollow(J, k);
+			break;
+		case OP_USEINPUTWP:
+		case OP_USEDATAWP:
+			JitCall(J, k);
+			JitFollowDynamic(J, k);
+			break;
+		case OP_EXECDATA:
+		case OP_FUNCEXEC:
+			// The called code runs on the interpreter
+			JitCallHandler(J, k, Engine_Call);
+			break;
+		default:
+			JitCall(J, k);
+			break;
+	}
+}
+
+// Free the buffers of J and its native code (if it got that far)
+static void JitFree(jit_t *J, unsigned char *native) {
+	if (native)
+		munmap(native, J->length);
+	free(J->code);
+	free(J->native);
+	free(J->fixups);
+	free(J->addresses);
+}
+
+int Jit_Run(East_State *E) {
+	code_t *code = E->code;
+	jit_t jit;
+	jit_t *J = &jit;
+
+	// The pc is stored as a 32 bit immediate
+	if (code->length > INT32_MAX)
+		return 0;
+
+	J->E = E;
+	J->length = 0;
+	J->size = 256;
+	J->code = malloc(J->size);
+	J->native = malloc(sizeof(size_t)*code->length);
+	J->fixups_length = 0;
+	J->fixups_size = 16;
+	J->fixups = malloc(sizeof(fixup_t)*J->fixups_size);
+	J->addresses = malloc(sizeof(void*)*code->length);
+
+	if (!J->code || !J->native || !J->fixups || !J->addresses)
+		JIT_ERR("Out of memory");
+
+	// push rbx, rbp, r12, r13, r14, r15; sub rsp, 8 (to keep the stack aligned for calls); mov rbx, rdi
+	EMIT(0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57, 0x48, 0x83, 0xEC, 0x08, 0x48, 0x89, 0xFB);
+	JitLoad(J);
+
+	for (pc_t k = 0; k < code->length; k++) {
+		J->native[k] = J->length;
+		JitInstruction(J, k);
+	}
+
+	for (size_t i = 0; i < J->fixups_length; i++) {
+		uint32_t rel = J->native[J->fixups[i].target] - (J->fixups[i].at + 4);
+		memcpy(J->code + J->fixups[i].at, &rel, 4);
+	}
+
+	// Writable while copying, executable after that
+	unsigned char *native = mmap(NULL, J->length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (native == MAP_FAILED) {
+		JitFree(J, NULL);
+		return 0;
+	}
+
+	memcpy(native, J->code, J->length);
+
+	// Systems that refuse executable memory (as with SELinux's execmem) get the interpreter instead
+	if (mprotect(native, J->length, PROT_READ | PROT_EXEC) != 0) {
+		JitFree(J, native);
+		return 0;
+	}
+
+	for (pc_t k = 0; k < code->length; k++)
+		J->addresses[k] = native + J->native[k];
+
+	// Converting from a data pointer to a function one isn't allowed by ISO C, but POSIX requires it to work
+	void (*run)(East_State*);
+	*(void**)&run = native;
+
+	// An error leaves the native code halfway, it still has to be freed
+	jmp_buf jump;
+	jmp_buf *outer = Error_Jump;
+
+	if (outer) {
+		Error_Jump = &jump;
+
+		if (setjmp(jump)) {
+			Error_Jump = outer;
+			JitFree(J, native);
+			longjmp(*outer, 1);
+		}
+	}
+
+	run(E);
+
+	Error_Jump = outer;
+	JitFree(J, native);
+	return 1;
+}
+
+#else
+
+int Jit_Run(East_State *E) {
+	(void)E;
+	return 0;
+}
+
+#endif // EAST_JIT
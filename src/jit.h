@@ -0,0 +1,31 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef EAST_JIT_H
+#define EAST_JIT_H
+
+#include "instructions.h"
+
+// Only x86-64 on systems with mmap is supported, everything else always uses the interpreter
+#if defined(__x86_64__) && defined(__unix__) && !defined(EAST_NO_JIT)
+#define EAST_JIT
+#endif
+
+// Compile the code of E to native code and run it, returns 0 without running anything if that isn't possible
+int Jit_Run(East_State *E);
+
+#endif // EAST_JIT_H
@@ -0,0 +1,301 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "instructions.h"
+#include "engine.h"
+#include "jit.h"
+
+// Free what E allocated while running and give the data back, a tail call may have replaced the script
+static void ExecuteEnd(East_State *E, data_t *data) {
+	if (E->func)
+		Inst_Release(E->func);
+
+	// Callers left by an error
+	for (size_t i = 0; i < E->frames_length; i++)
+		if (E->frames[i].func)
+			Inst_Release(E->frames[i].func);
+
+	for (size_t i = 0; i < E->frames_size; i++) {
+		if (E->frames[i].data_waypoint.items)
+			WP_Delete(&E->frames[i].data_waypoint);
+		if (E->frames[i].input_waypoint.items)
+			WP_Delete(&E->frames[i].input_waypoint);
+	}
+
+	free(E->frames);
+	WP_Delete(&E->data_waypoint);
+	WP_Delete(&E->input_waypoint);
+	*data = E->data;
+}
+
+// Run E until it ends, if the caller can recover from errors they clean E up before going back to it
+static void ExecuteRun(East_State *E, data_t *data) {
+	jmp_buf jump;
+	jmp_buf *outer = Error_Jump;
+
+	if (outer) {
+		Error_Jump = &jump;
+
+		if (setjmp(jump)) {
+			Error_Jump = outer;
+			ExecuteEnd(E, data);
+			longjmp(*outer, 1);
+		}
+	}
+
+	// Only the script itself gets compiled to native code, `=` and `$` run on the interpreter (and everything does when profiling)
+	if (!(E->run->jit && !E->run->profile && Jit_Run(E)))
+		Engine_Run(E);
+
+	Error_Jump = outer;
+}
+
+// Execute compiled code on an isolated container, only provides access to the data and the input string
+// The string is the one the code was compiled from, used for error messages
+void ExecuteCode(char *string, size_t length, code_t *code, data_t *data, const inst_t *instr, uinst_t **userinstr, char *input, size_t input_length, run_t *run) {
+	East_State E;
+	// Program counter
+	E.pc = 0;
+	// Current character on the input string
+	E.input_index = 0;
+	// Waypoints for both of the previous variables, used to go back
+	E.data_waypoint  = WP_Create();
+	E.input_waypoint = WP_Create();
+
+	E.exec  = string;
+	E.exec_length = length;
+	E.code  = code;
+	E.input = input;
+	E.input_length = input_length;
+	E.data  = *data;
+	E.instr = instr;
+	E.userinstr = *userinstr;
+	E.run   = run;
+
+	// `=` and `$` push their caller here
+	E.func = NULL;
+	E.frames = NULL;
+	E.frames_length = 0;
+	E.frames_size = 0;
+	E.frames_base = 0;
+
+	ExecuteRun(&E, data);
+	ExecuteEnd(&E, data);
+}
+
+// Execute a string, compiling it first
+void ExecuteString(char *string, size_t length, data_t *data, const inst_t *instr, uinst_t **userinstr, char *input, size_t input_length, run_t *run) {
+	// Compile once, so whitespace, comments and loop targets are only handled here
+	code_t code = Code_Compile(string, length, run->optimize);
+
+	ExecuteCode(string, length, &code, data, instr, userinstr, input, input_length, run);
+	Code_Delete(&code);
+}
+
+// Compiled script of an engine, with its own copy of the string
+struct east_script_t {
+	char *string;
+	size_t length;
+	code_t code;
+};
+
+void East_Options(east_options_t *options) {
+	options->optimize = 1;
+	options->jit = 0;
+	options->max_depth = EAST_MAX_DEPTH;
+	options->write = NULL;
+	options->user = NULL;
+	options->fd = 1;
+	options->line_flush = 0;
+	options->profile = 0;
+}
+
+east_t *East_Create(const east_options_t *options) {
+	east_options_t defaults;
+	if (!options) {
+		East_Options(&defaults);
+		options = &defaults;
+	}
+
+	east_t *engine = calloc(1, sizeof(east_t));
+	if (!engine)
+		return NULL;
+
+	// Only running out of memory can fail here, the engine is deleted with what it had so far
+	jmp_buf jump;
+	jmp_buf *outer = Error_Jump;
+	Error_Jump = &jump;
+
+	if (setjmp(jump)) {
+		Error_Jump = outer;
+		East_Delete(engine);
+		return NULL;
+	}
+
+	engine->run.optimize = options->optimize;
+	engine->run.jit = options->jit;
+	engine->run.max_depth = options->max_depth;
+	engine->run.pool = Pool_Create();
+
+#ifdef EAST_PROFILE
+	if (options->profile)
+		engine->run.profile = Prof_Create(options->profile == 2 || options->profile == 4, options->profile >= 3);
+#endif
+
+	if (options->write)
+		engine->run.out = Out_Callback(options->write, options->user, options->line_flush);
+	else
+		engine->run.out = Out_Create(options->fd, options->line_flush);
+
+	for (size_t i = 0; i < EAST_DATA_MODES; i++)
+		engine->data[i] = Data_Create((dmode_t)i);
+	engine->userinstr = Inst_UCreate();
+
+	Error_Jump = outer;
+	return engine;
+}
+
+void East_Delete(east_t *engine) {
+	Out_Delete(&engine->run.out);
+
+	for (size_t i = 0; i < EAST_DATA_MODES; i++)
+		Data_Delete(&engine->data[i]);
+
+	// Missing if East_Create ran out of memory
+	if (engine->userinstr)
+		Inst_UDelete(engine->userinstr);
+	Inst_CacheDelete(&engine->run);
+	Pool_Delete(&engine->run.pool);
+	if (engine->run.profile)
+		Prof_Delete(engine->run.profile);
+	free(engine);
+}
+
+east_script_t *East_Compile(east_t *engine, const char *script, size_t length, east_error_t *error) {
+	east_script_t *S = malloc(sizeof(east_script_t));
+	char *string = malloc(length + 1);
+
+	if (!S || !string) {
+		free(S);
+		free(string);
+		if (error)
+			*error = (east_error_t){"Out of memory", 0, 0};
+		return NULL;
+	}
+
+	memcpy(string, script, length);
+	string[length] = '\0';
+
+	jmp_buf jump;
+	jmp_buf *outer = Error_Jump;
+	Error_Jump = &jump;
+
+	if (setjmp(jump)) {
+		Error_Jump = outer;
+		free(S);
+		free(string);
+		if (error)
+			*error = Error_Last;
+		return NULL;
+	}
+
+	S->string = string;
+	S->length = length;
+	S->code = Code_Compile(string, length, engine->run.optimize);
+
+	Error_Jump = outer;
+	return S;
+}
+
+void East_ScriptDelete(east_t *engine, east_script_t *script) {
+	(void)engine;
+
+	Code_Delete(&script->code);
+	free(script->string);
+	free(script);
+}
+
+int East_Run(east_t *engine, east_script_t *script, east_mode_t mode, const char *input, size_t length, east_error_t *error) {
+	// The enum is as wide as an int, callers can pass anything
+	if ((unsigned)mode >= EAST_DATA_MODES) {
+		if (error)
+			*error = (east_error_t){"Unknown mode", 0, 0};
+		return EAST_ERROR;
+	}
+
+	// Both enums have the same order
+	data_t *data = &engine->data[mode];
+	int status = EAST_OK;
+
+	// Emptied, the buffers are reused by the next run
+	data->head = 0;
+	data->length = 0;
+	data->reversed = 0;
+
+	jmp_buf jump;
+	jmp_buf *outer = Error_Jump;
+	Error_Jump = &jump;
+
+	if (setjmp(jump)) {
+		status = EAST_ERROR;
+		if (error)
+			*error = Error_Last;
+	} else {
+		// Nothing writes to the input
+		ExecuteCode(script->string, script->length, &script->code, data, Inst_Get(data->mode), &engine->userinstr, (char*)input, length, &engine->run);
+	}
+
+	Error_Jump = outer;
+	Inst_UClear(engine->userinstr);
+	Out_Flush(&engine->run.out);
+
+	return status;
+}
+
+void East_PrintError(const east_error_t *error, FILE *fp) {
+	if (error->position)
+		fprintf(fp, "East, error while interpreting\nCharacter %zu ('%c'): %s\n", error->position, error->character, error->message);
+	else
+		fprintf(fp, "East, fatal error: %s\n", error->message);
+}
+
+void East_Stats(const east_t *engine, east_stats_t *stats) {
+	const run_t *run = &engine->run;
+
+	stats->exec_hits = run->exec_hits;
+	stats->exec_misses = run->exec_misses;
+	stats->calls = run->calls;
+	stats->tail_calls = run->tail_calls;
+	stats->wp_creates = run->wp_creates;
+	stats->pool_mallocs = run->pool.mallocs;
+	stats->pool_reuses = run->pool.reuses;
+}
+
+int East_Profile(const east_t *engine, FILE *fp, const char *name) {
+	prof_t *profile = engine->run.profile;
+
+	if (!profile)
+		return EAST_ERROR;
+
+	if (profile->stacks)
+		Prof_Stacks(profile, fp, name);
+	else
+		Prof_Report(profile, fp, name);
+
+	return EAST_OK;
+}
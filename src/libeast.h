@@ -0,0 +1,128 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Embeddable East: engines compile scripts and run them on inputs, errors are returned instead of exiting
+// Engines don't share anything, different threads can use different engines at once (but not the same one)
+// Built with `make lib` (libeast.a and libeast.so)
+
+#ifndef LIBEAST_H
+#define LIBEAST_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// libeast.so is built with -fvisibility=hidden, only what is marked with EAST_API is exported
+#ifdef __GNUC__
+#define EAST_API __attribute__((visibility("default")))
+#else
+#define EAST_API
+#endif
+
+typedef struct east_t east_t;
+typedef struct east_script_t east_script_t;
+
+// Type of the items on the data, same as -c, -f, -d, -i and -l
+typedef enum {
+	EAST_MODE_CHAR,
+	EAST_MODE_FLOAT,
+	EAST_MODE_DOUBLE,
+	EAST_MODE_INT,
+	EAST_MODE_LONG
+} east_mode_t;
+
+// Receives the output of a run, in pieces (all of them before East_Run returns)
+typedef void (*east_write_t)(void *user, const char *string, size_t length);
+
+typedef struct {
+	// Replace common idioms with fused instructions, as without -u (1)
+	int optimize;
+	// Compile scripts to native code where supported, as with -J (0)
+	int jit;
+	// Nested `=` and `$` calls allowed, as with -r (100000)
+	size_t max_depth;
+	// The output goes to write, or to the file descriptor fd if write is NULL (NULL and standard output)
+	east_write_t write;
+	void *user;
+	int fd;
+	// Flush the output after every newline, as with -t (0)
+	int line_flush;
+	// Count the instructions run, as with -P: 1 counts them, 2 times them too, 3 and 4 do the same by call stack (0)
+	// Only libraries built with EAST_PROFILE (make PROFILE=1) count anything
+	int profile;
+} east_options_t;
+
+// What an engine did over all of its runs, as printed by -s
+typedef struct {
+	// `=` found the code already compiled, or had to compile it
+	size_t exec_hits;
+	size_t exec_misses;
+	size_t calls;
+	size_t tail_calls;
+	size_t wp_creates;
+	// Blocks of the call frames allocated, and the ones reused instead
+	size_t pool_mallocs;
+	size_t pool_reuses;
+} east_stats_t;
+
+// Results of East_Run
+#define EAST_OK 0
+#define EAST_ERROR 1
+
+// What stopped a run, position is the character of the script it happened on (from 1), 0 if it isn't about one (like running out of memory)
+typedef struct {
+	const char *message;
+	size_t position;
+	char character;
+} east_error_t;
+
+// Fill options with the defaults
+EAST_API void East_Options(east_options_t *options);
+
+// New engine, NULL options for the defaults, returns NULL if there is no memory for it
+EAST_API east_t *East_Create(const east_options_t *options);
+EAST_API void East_Delete(east_t *engine);
+
+// Compile a script for the engine, which keeps a copy of it, returns NULL and fills error if there is no memory for it
+// Mistakes on the script (like unmatched brackets) are errors of the runs, same as in East
+EAST_API east_script_t *East_Compile(east_t *engine, const char *script, size_t length, east_error_t *error);
+EAST_API void East_ScriptDelete(east_t *engine, east_script_t *script);
+
+// Run a script of the engine on input, with an empty data and no user defined instructions, like a new East would
+// Returns EAST_OK, or EAST_ERROR with error filled (if it isn't NULL), the output written before the error is kept
+// A mode that isn't one of east_mode_t is an error, without running anything
+EAST_API int East_Run(east_t *engine, east_script_t *script, east_mode_t mode, const char *input, size_t length, east_error_t *error);
+
+// Print an error as East does
+EAST_API void East_PrintError(const east_error_t *error, FILE *fp);
+
+// Fill stats with what the engine did so far
+EAST_API void East_Stats(const east_t *engine, east_stats_t *stats);
+
+// Print what the profiler counted on every run of the engine, as -P does, name is what the script is called on it
+// Returns EAST_ERROR if nothing was counted (the profile option was 0, or the library was built without the profiler)
+EAST_API int East_Profile(const east_t *engine, FILE *fp, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBEAST_H
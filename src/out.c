@@ -0,0 +1,162 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+// write and isatty are POSIX
+#define _POSIX_C_SOURCE 200112L
+
+#include "out.h"
+
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+// Initialize an out_t that writes to the given file descriptor
+out_t Out_Create(int fd, int line_flush) {
+	out_t tmp;
+
+	tmp.length = 0;
+	tmp.size = EAST_OUT_SIZE;
+	tmp.fd = fd;
+	tmp.line_flush = line_flush && fd >= 0 && isatty(fd);
+	tmp.write = NULL;
+	tmp.user = NULL;
+	tmp.buffer = malloc(tmp.size);
+
+	if (!tmp.buffer)
+		OUT_ERR("Out of memory");
+
+	return tmp;
+}
+
+// Initialize an out_t that keeps everything in memory, read from buffer and emptied by setting length to 0
+out_t Out_Memory() {
+	return Out_Create(-1, 0);
+}
+
+// Initialize an out_t that gives what it flushes to write
+out_t Out_Callback(void (*write)(void *user, const char *string, size_t length), void *user, int line_flush) {
+	out_t tmp = Out_Create(-1, 0);
+
+	tmp.line_flush = line_flush;
+	tmp.write = write;
+	tmp.user = user;
+
+	return tmp;
+}
+
+// Flush what is left and free the buffer
+void Out_Delete(out_t *O) {
+	Out_Flush(O);
+	free(O->buffer);
+	O->buffer = NULL;
+	O->size = 0;
+}
+
+// Function only used on this file, write(2) until everything is written
+static void OutWriteAll(int fd, const char *string, size_t length) {
+	size_t done = 0;
+
+	while (done < length) {
+		ssize_t written = write(fd, string + done, length - done);
+
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			// Nowhere to report it, the output is lost anyway
+			return;
+		}
+
+		done += written;
+	}
+}
+
+// Send a string to wherever O writes
+static void OutSend(out_t *O, const char *string, size_t length) {
+	if (O->write) {
+		if (length)
+			O->write(O->user, string, length);
+	} else
+		OutWriteAll(O->fd, string, length);
+}
+
+// Make room for length more bytes, for outputs in memory
+static void OutGrow(out_t *O, size_t length) {
+	size_t size = O->size;
+
+	while (O->length + length > size)
+		size *= 2;
+
+	char *tmp = realloc(O->buffer, size);
+	if (!tmp)
+		OUT_ERR("Out of memory");
+
+	O->buffer = tmp;
+	O->size = size;
+}
+
+// Write everything on the buffer, in memory there is nowhere to write so it only makes room
+void Out_Flush(out_t *O) {
+	if (O->fd < 0 && !O->write) {
+		if (O->length == O->size)
+			OutGrow(O, 1);
+		return;
+	}
+
+	OutSend(O, O->buffer, O->length);
+	O->length = 0;
+}
+
+// Write a string, big ones skip the buffer
+void Out_Write(out_t *O, const char *string, size_t length) {
+	if (O->length + length > O->size) {
+		if (O->fd < 0 && !O->write) {
+			OutGrow(O, length);
+		} else {
+			Out_Flush(O);
+
+			if (length > O->size) {
+				OutSend(O, string, length);
+				return;
+			}
+		}
+	}
+
+	memcpy(O->buffer + O->length, string, length);
+	O->length += length;
+
+	if (O->line_flush && memchr(string, '\n', length))
+		Out_Flush(O);
+}
+
+// Same as printf, used for printing numbers
+void Out_Format(out_t *O, const char *format, ...) {
+	// Big enough for any double printed with %f
+	char tmp[512];
+	va_list args;
+
+	va_start(args, format);
+	int length = vsnprintf(tmp, sizeof(tmp), format, args);
+	va_end(args);
+
+	if (length < 0)
+		return;
+	if ((size_t)length >= sizeof(tmp))
+		length = sizeof(tmp) - 1;
+
+	Out_Write(O, tmp, length);
+}
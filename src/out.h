@@ -0,0 +1,62 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef EAST_OUT_H
+#define EAST_OUT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "error.h"
+
+#define OUT_ERR(msg) Error_Raise(msg, 0, 0)
+
+// Size of the output buffer
+#define EAST_OUT_SIZE 65536
+
+// Buffered output of the interpreter, shared by every ExecuteString of a run
+typedef struct {
+	char *buffer;
+	size_t length;
+	size_t size;
+	int fd;
+	// Flush after every newline, only enabled if fd is a terminal (or on callbacks)
+	int line_flush;
+	// Called with everything flushed instead of writing to fd, if set
+	void (*write)(void *user, const char *string, size_t length);
+	void *user;
+} out_t;
+
+// Write a character, flushing if the buffer is full (or on newlines, if enabled)
+#define OUT_CHAR(O, c) do { \
+	int out_c = (c); \
+	if ((O)->length == (O)->size) \
+		Out_Flush(O); \
+	(O)->buffer[(O)->length++] = (char)out_c; \
+	if (out_c == '\n' && (O)->line_flush) \
+		Out_Flush(O); \
+} while (0)
+
+out_t Out_Create(int fd, int line_flush);
+out_t Out_Memory();
+out_t Out_Callback(void (*write)(void *user, const char *string, size_t length), void *user, int line_flush);
+void Out_Delete(out_t *O);
+void Out_Flush(out_t *O);
+void Out_Write(out_t *O, const char *string, size_t length);
+void Out_Format(out_t *O, const char *format, ...);
+
+#endif // EAST_OUT_H
@@ -0,0 +1,90 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "pool.h"
+
+// Free blocks hold the next one in their first bytes
+typedef struct pool_block {
+	struct pool_block *next;
+} pool_block_t;
+
+// Smallest class that fits size, EAST_POOL_CLASSES if none does
+static size_t PoolClass(size_t size) {
+	size_t class = 0;
+
+	while (class < EAST_POOL_CLASSES && ((size_t)16 << class) < size)
+		class++;
+
+	return class;
+}
+
+pool_t Pool_Create() {
+	pool_t tmp;
+
+	for (size_t i = 0; i < EAST_POOL_CLASSES; i++)
+		tmp.free[i] = NULL;
+	tmp.mallocs = 0;
+	tmp.reuses = 0;
+
+	return tmp;
+}
+
+void Pool_Delete(pool_t *P) {
+	for (size_t i = 0; i < EAST_POOL_CLASSES; i++) {
+		pool_block_t *block = P->free[i];
+
+		while (block) {
+			pool_block_t *next = block->next;
+			free(block);
+			block = next;
+		}
+
+		P->free[i] = NULL;
+	}
+}
+
+void *Pool_Alloc(pool_t *P, size_t size) {
+	size_t class = PoolClass(size);
+
+	if (class < EAST_POOL_CLASSES && P->free[class]) {
+		pool_block_t *block = P->free[class];
+		P->free[class] = block->next;
+		P->reuses++;
+		return block;
+	}
+
+	// Allocate the whole class, so the block fits anything else of it later
+	void *block = malloc((class < EAST_POOL_CLASSES) ? (size_t)16 << class : size);
+	if (!block)
+		POOL_ERR("Out of memory");
+
+	P->mallocs++;
+	return block;
+}
+
+void Pool_Free(pool_t *P, void *block, size_t size) {
+	size_t class = PoolClass(size);
+
+	if (class == EAST_POOL_CLASSES) {
+		free(block);
+		return;
+	}
+
+	((pool_block_t*)block)->next = P->free[class];
+	P->free[class] = block;
+}
@@ -0,0 +1,46 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef EAST_POOL_H
+#define EAST_POOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "error.h"
+
+#define POOL_ERR(msg) Error_Raise(msg, 0, 0)
+
+// Size classes are powers of 2 from 16 bytes up to this one, bigger blocks go straight to malloc
+#define EAST_POOL_CLASSES 13
+
+// Free lists of blocks that were used and given back, kept for later allocations of the same class instead of going back to malloc
+typedef struct {
+	void *free[EAST_POOL_CLASSES];
+	// Blocks that came from malloc and blocks taken from the free lists
+	size_t mallocs;
+	size_t reuses;
+} pool_t;
+
+pool_t Pool_Create();
+void Pool_Delete(pool_t *P);
+// The size given back has to be the same used to allocate
+void *Pool_Alloc(pool_t *P, size_t size);
+void Pool_Free(pool_t *P, void *block, size_t size);
+
+#endif // EAST_POOL_H
@@ -0,0 +1,490 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// clock_gettime is POSIX
+#define _POSIX_C_SOURCE 200112L
+
+#include "profile.h"
+
+#include <time.h>
+
+// The time stamp counter where there is one, the monotonic clock otherwise
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define PROF_RDTSC
+#define PROF_UNIT "cycles"
+#else
+#define PROF_UNIT "ns"
+#endif
+
+// How each opcode is shown on the report
+static const char *names[OP_COUNT] = {
+	[OP_NEXTCHAR]    = ">",
+	[OP_PREVCHAR]    = "<",
+	[OP_PUSHITEM]    = ".",
+	[OP_POPITEM]     = ",",
+	[OP_DUPITEM]     = "&",
+	[OP_PRINTCHAR]   = ";",
+	[OP_PRINTNUMBER] = ":",
+	[OP_ADD]         = "+",
+	[OP_SUB]         = "-",
+	[OP_MULT]        = "*",
+	[OP_DIV]         = "/",
+	[OP_REVERSE]     = "!",
+	[OP_ROTATE]      = "@",
+	[OP_EXECDATA]    = "=",
+	[OP_PUSH]        = "literal",
+	[OP_SETINPUTWP]  = "[",
+	[OP_USEINPUTWP]  = "]",
+	[OP_SETDATAWP]   = "{",
+	[OP_USEDATAWP]   = "}",
+	[OP_INPUTLOOP]   = "] (paired)",
+	[OP_DATALOOP]    = "} (paired)",
+	[OP_IFNOTEQUAL]  = "?",
+	[OP_FUNCDEC]     = "%",
+	[OP_FUNCEXEC]    = "$",
+	[OP_JUMP]        = "jump",
+	[OP_ERROR]       = "error",
+	[OP_PUSHINPUT]   = "[.>]",
+	[OP_CATINPUT]    = "[.;>]",
+	[OP_PRINTDATA]   = "{;}",
+	[OP_ROTATEBACK]  = "!@!",
+	[OP_ADDCONST]    = "literal +",
+	[OP_SEGMAP]      = "| (map)",
+	[OP_SEGREDUCE]   = "| (reduce)",
+	[OP_SCAN]        = "| (scan)",
+	[OP_SAFEPOP]     = ", (unchecked)",
+	[OP_SAFEDUP]     = "& (unchecked)",
+	[OP_SAFEPRINT]   = "; (unchecked)",
+	[OP_SAFEADD]     = "+ (unchecked)",
+	[OP_SAFESUB]     = "- (unchecked)",
+	[OP_SAFEMULT]    = "* (unchecked)",
+	[OP_SAFEDIV]     = "/ (unchecked)",
+	[OP_SAFEADDCONST] = "literal + (unchecked)",
+	[OP_NOP]         = "nop",
+	[OP_END]         = "end"
+};
+
+// A line of the report
+typedef struct {
+	// What it is sorted by, the time if timing and the count otherwise
+	uint64_t cost;
+	uint64_t count;
+	uint64_t cycles;
+	prof_code_t *code;
+	size_t index;
+} prof_line_t;
+
+static uint64_t ProfClock() {
+#ifdef PROF_RDTSC
+	return __rdtsc();
+#else
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+#endif
+}
+
+static void *ProfAlloc(size_t size) {
+	void *tmp = calloc(1, size ? size : 1);
+	if (!tmp)
+		PROF_ERR("Out of memory");
+
+	return tmp;
+}
+
+prof_t *Prof_Create(int timing, int stacks) {
+	prof_t *P = ProfAlloc(sizeof(prof_t));
+
+	P->timing = timing;
+	P->stacks = stacks;
+	P->codes_size = 16;
+	P->codes = ProfAlloc(sizeof(prof_code_t*)*P->codes_size);
+
+	if (stacks) {
+		P->root = ProfAlloc(sizeof(prof_node_t));
+		P->node = P->root;
+	}
+
+	return P;
+}
+
+static void ProfNodeDelete(prof_node_t *N) {
+	for (size_t i = 0; i < N->children_length; i++)
+		ProfNodeDelete(N->children[i]);
+
+	free(N->children);
+	free(N->counts);
+	free(N->cycles);
+	free(N);
+}
+
+void Prof_Delete(prof_t *P) {
+	if (P->root)
+		ProfNodeDelete(P->root);
+	free(P->stack);
+
+	for (size_t i = 0; i < P->codes_length; i++) {
+		prof_code_t *C = P->codes[i];
+		free(C->string);
+		free(C->opcodes);
+		free(C->positions);
+		free(C->counts);
+		free(C->cycles);
+		free(C);
+	}
+
+	free(P->codes);
+	free(P);
+}
+
+// Name of the code E is running
+static void ProfLabel(East_State *E, char *label, size_t size) {
+	if (!E->func) {
+		snprintf(label, size, "script");
+	} else if (E->func->name >= 0) {
+		unsigned char name = E->func->name;
+		if (name > ' ' && name < 127)
+			snprintf(label, size, "$%c", name);
+		else
+			snprintf(label, size, "$\\x%02x", name);
+	} else {
+		// The start of the string, newlines and the like escaped
+		size_t j = snprintf(label, size, "=\"");
+		for (size_t i = 0; i < E->exec_length && j + 3 < size; i++)
+			label[j++] = (E->exec[i] >= ' ' && E->exec[i] < 127) ? E->exec[i] : '?';
+		label[j++] = '"';
+		label[j] = '\0';
+	}
+}
+
+prof_code_t *Prof_Code(prof_t *P, East_State *E) {
+	code_t *code = E->code;
+
+	if (code->profile)
+		return code->profile;
+
+	char label[sizeof(((prof_code_t*)0)->label)];
+	ProfLabel(E, label, sizeof(label));
+
+	size_t hash = 2166136261u;
+	for (size_t i = 0; i < E->exec_length; i++)
+		hash = (hash ^ (unsigned char)E->exec[i]) * (size_t)16777619u;
+
+	// The same string compiles to the same code, so a string run again by `=` after leaving its cache keeps its counts
+	for (size_t i = 0; i < P->codes_length; i++) {
+		prof_code_t *C = P->codes[i];
+		if (C->hash == hash && C->length == E->exec_length && C->ops == code->length && strcmp(C->label, label) == 0 && memcmp(C->string, E->exec, C->length) == 0) {
+			code->profile = C;
+			return C;
+		}
+	}
+
+	prof_code_t *C = ProfAlloc(sizeof(prof_code_t));
+	memcpy(C->label, label, sizeof(label));
+	C->string = ProfAlloc(E->exec_length);
+	memcpy(C->string, E->exec, E->exec_length);
+	C->length = E->exec_length;
+	C->hash = hash;
+	C->ops = code->length;
+	C->opcodes = ProfAlloc(code->length);
+	C->positions = ProfAlloc(sizeof(pc_t)*code->length);
+	C->counts = ProfAlloc(sizeof(uint64_t)*code->length);
+	C->cycles = ProfAlloc(sizeof(uint64_t)*code->length);
+
+	for (size_t i = 0; i < code->length; i++) {
+		C->opcodes[i] = code->ops[i].op;
+		C->positions[i] = code->ops[i].pos;
+	}
+
+	if (P->codes_length == P->codes_size) {
+		prof_code_t **tmp = realloc(P->codes, sizeof(prof_code_t*)*P->codes_size*2);
+		if (!tmp)
+			PROF_ERR("Out of memory");
+
+		P->codes = tmp;
+		P->codes_size *= 2;
+	}
+
+	P->codes[P->codes_length++] = C;
+	code->profile = C;
+
+	return C;
+}
+
+// Node of the code C called on pc by N, made on the first call
+static prof_node_t *ProfChild(prof_node_t *N, prof_code_t *C, pc_t pc) {
+	for (size_t i = 0; i < N->children_length; i++) {
+		if (N->children[i]->code == C && N->children[i]->call == pc)
+			return N->children[i];
+	}
+
+	if (N->children_length == N->children_size) {
+		size_t size = N->children_size ? N->children_size*2 : 4;
+		prof_node_t **tmp = realloc(N->children, sizeof(prof_node_t*)*size);
+		if (!tmp)
+			PROF_ERR("Out of memory");
+
+		N->children = tmp;
+		N->children_size = size;
+	}
+
+	prof_node_t *child = ProfAlloc(sizeof(prof_node_t));
+	child->code = C;
+	child->parent = N;
+	child->call = pc;
+	child->depth = N->depth + 1;
+	child->counts = ProfAlloc(sizeof(uint64_t)*C->ops);
+	child->cycles = ProfAlloc(sizeof(uint64_t)*C->ops);
+
+	N->children[N->children_length++] = child;
+	return child;
+}
+
+void Prof_Step(prof_t *P, East_State *E, pc_t pc) {
+	prof_code_t *C = E->code->profile ? E->code->profile : Prof_Code(P, E);
+	unsigned char op = C->opcodes[pc];
+
+	// Returning is part of the call, the engines don't agree on whether it is an instruction
+	if (op == OP_END)
+		return;
+
+	C->counts[pc]++;
+	P->op_counts[op]++;
+
+	uint64_t *cycles = &C->cycles[pc];
+
+	if (P->stacks) {
+		// A new script (or one left by an error) starts from the root again
+		if (P->node->code != C) {
+			P->node = ProfChild(P->root, C, 0);
+			P->stack_length = 0;
+		}
+
+		P->node->counts[pc]++;
+		cycles = &P->node->cycles[pc];
+	}
+
+	if (!P->timing)
+		return;
+
+	// The time since the last instruction started is what it took
+	uint64_t now = ProfClock();
+	if (P->last_cycles) {
+		*P->last_cycles += now - P->last;
+		P->op_cycles[P->last_op] += now - P->last;
+		if (P->last_stack_cycles)
+			*P->last_stack_cycles += now - P->last;
+	}
+
+	P->last = now;
+	P->last_cycles = &C->cycles[pc];
+	P->last_stack_cycles = P->stacks ? cycles : NULL;
+	P->last_op = op;
+}
+
+void Prof_Call(prof_t *P, East_State *E, pc_t pc, int tail) {
+	prof_code_t *C = Prof_Code(P, E);
+	C->calls++;
+
+	if (!P->stacks)
+		return;
+
+	prof_node_t *N = P->node;
+
+	// The called code takes the place of the caller
+	if (tail) {
+		P->node = ProfChild(N->parent ? N->parent : P->root, C, N->call);
+		return;
+	}
+
+	if (P->stack_length == P->stack_size) {
+		size_t size = P->stack_size ? P->stack_size*2 : 64;
+		prof_node_t **tmp = realloc(P->stack, sizeof(prof_node_t*)*size);
+		if (!tmp)
+			PROF_ERR("Out of memory");
+
+		P->stack = tmp;
+		P->stack_size = size;
+	}
+
+	P->stack[P->stack_length++] = N;
+	P->node = ProfChild(N->depth < EAST_PROFILE_DEPTH ? N : N->parent, C, pc);
+}
+
+void Prof_Return(prof_t *P) {
+	if (P->stacks && P->stack_length)
+		P->node = P->stack[--P->stack_length];
+}
+
+static int ProfCompare(const void *a, const void *b) {
+	uint64_t x = ((const prof_line_t*)a)->cost;
+	uint64_t y = ((const prof_line_t*)b)->cost;
+	return (x < y) - (x > y);
+}
+
+// Sort the lines by cost and print the first ones, what each line says is up to print
+static void ProfPrint(prof_t *P, FILE *fp, prof_line_t *lines, size_t length, uint64_t total, void (*print)(FILE*, prof_line_t*, const char*), const char *name) {
+	qsort(lines, length, sizeof(prof_line_t), ProfCompare);
+
+	for (size_t i = 0; i < length && i < EAST_PROFILE_TOP; i++) {
+		fprintf(fp, "  %12llu", (unsigned long long)lines[i].count);
+		if (P->timing)
+			fprintf(fp, " %14llu", (unsigned long long)lines[i].cycles);
+		fprintf(fp, " %5.1f%%  ", total ? 100.0 * lines[i].cost / total : 0.0);
+		print(fp, &lines[i], name);
+		fputc('\n', fp);
+	}
+
+	if (length > EAST_PROFILE_TOP)
+		fprintf(fp, "  (%zu more)\n", length - EAST_PROFILE_TOP);
+}
+
+// Line and column of the instruction on pc of the code
+static void ProfLineColumn(prof_code_t *C, pc_t pc, size_t *line, size_t *column) {
+	pc_t pos = C->positions[pc];
+	*line = 1;
+	*column = 1;
+
+	for (size_t i = 0; i < pos && i < C->length; i++) {
+		if (C->string[i] == '\n') {
+			(*line)++;
+			*column = 1;
+		} else {
+			(*column)++;
+		}
+	}
+}
+
+// line:column of a position of the code, and the instruction there
+static void ProfPrintPosition(FILE *fp, prof_line_t *L, const char *name) {
+	prof_code_t *C = L->code;
+	size_t line, column;
+	ProfLineColumn(C, L->index, &line, &column);
+
+	fprintf(fp, "%s:%zu:%zu %s", strcmp(C->label, "script") ? C->label : name, line, column, names[C->opcodes[L->index]]);
+}
+
+static void ProfPrintOp(FILE *fp, prof_line_t *L, const char *name) {
+	(void)name;
+	fprintf(fp, "%s", names[L->index]);
+}
+
+static void ProfPrintCode(FILE *fp, prof_line_t *L, const char *name) {
+	prof_code_t *C = L->code;
+	fprintf(fp, "%s (%llu calls)", strcmp(C->label, "script") ? C->label : name, (unsigned long long)C->calls);
+}
+
+void Prof_Report(prof_t *P, FILE *fp, const char *name) {
+	uint64_t count = 0;
+	uint64_t cycles = 0;
+	size_t positions = 0;
+
+	for (size_t i = 0; i < OP_COUNT; i++) {
+		count += P->op_counts[i];
+		cycles += P->op_cycles[i];
+	}
+
+	for (size_t i = 0; i < P->codes_length; i++)
+		positions += P->codes[i]->ops;
+
+	uint64_t total = P->timing ? cycles : count;
+	prof_line_t *lines = ProfAlloc(sizeof(prof_line_t)*(positions > OP_COUNT ? positions : OP_COUNT));
+	size_t length = 0;
+
+	fprintf(fp, "East, profile: %llu instructions", (unsigned long long)count);
+	if (P->timing)
+		fprintf(fp, ", %llu " PROF_UNIT, (unsigned long long)cycles);
+	fprintf(fp, "\n  %12s", "count");
+	if (P->timing)
+		fprintf(fp, " %14s", PROF_UNIT);
+	fprintf(fp, " %6s\n", "share");
+
+	// Every instruction that ran
+	fprintf(fp, " by position:\n");
+	for (size_t i = 0; i < P->codes_length; i++) {
+		prof_code_t *C = P->codes[i];
+		for (size_t k = 0; k < C->ops; k++) {
+			if (C->counts[k])
+				lines[length++] = (prof_line_t){P->timing ? C->cycles[k] : C->counts[k], C->counts[k], C->cycles[k], C, k};
+		}
+	}
+	ProfPrint(P, fp, lines, length, total, ProfPrintPosition, name);
+
+	fprintf(fp, " by instruction:\n");
+	length = 0;
+	for (size_t i = 0; i < OP_COUNT; i++) {
+		if (P->op_counts[i])
+			lines[length++] = (prof_line_t){P->timing ? P->op_cycles[i] : P->op_counts[i], P->op_counts[i], P->op_cycles[i], NULL, i};
+	}
+	ProfPrint(P, fp, lines, length, total, ProfPrintOp, name);
+
+	// The script, each user defined instruction and each string run by `=`, counting only their own instructions
+	fprintf(fp, " by code:\n");
+	length = 0;
+	for (size_t i = 0; i < P->codes_length; i++) {
+		prof_code_t *C = P->codes[i];
+		prof_line_t L = {0, 0, 0, C, i};
+
+		for (size_t k = 0; k < C->ops; k++) {
+			L.count += C->counts[k];
+			L.cycles += C->cycles[k];
+		}
+
+		L.cost = P->timing ? L.cycles : L.count;
+		lines[length++] = L;
+	}
+	ProfPrint(P, fp, lines, length, total, ProfPrintCode, name);
+
+	free(lines);
+}
+
+// The frames from the root to N, each on the position of the call to the next one and N on pc
+static void ProfPrintStack(FILE *fp, prof_node_t *N, pc_t pc, const char *name) {
+	if (N->parent->code) {
+		ProfPrintStack(fp, N->parent, N->call, name);
+		fputc(';', fp);
+	}
+
+	// Separates the frames on the collapsed format
+	for (const char *c = strcmp(N->code->label, "script") ? N->code->label : name; *c; c++)
+		fputc(*c == ';' ? '?' : *c, fp);
+
+	size_t line, column;
+	ProfLineColumn(N->code, pc, &line, &column);
+	fprintf(fp, ":%zu:%zu", line, column);
+}
+
+static void ProfPrintNode(prof_t *P, FILE *fp, prof_node_t *N, const char *name) {
+	for (size_t k = 0; N->code && k < N->code->ops; k++) {
+		uint64_t weight = P->timing ? N->cycles[k] : N->counts[k];
+		if (!weight)
+			continue;
+
+		ProfPrintStack(fp, N, k, name);
+		fprintf(fp, " %llu\n", (unsigned long long)weight);
+	}
+
+	for (size_t i = 0; i < N->children_length; i++)
+		ProfPrintNode(P, fp, N->children[i], name);
+}
+
+void Prof_Stacks(prof_t *P, FILE *fp, const char *name) {
+	if (P->root)
+		ProfPrintNode(P, fp, P->root, name);
+}
@@ -0,0 +1,112 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef EAST_PROFILE_H
+#define EAST_PROFILE_H
+
+#include "globals.h"
+
+#include <stdint.h>
+
+// Only engines built with EAST_PROFILE (make PROFILE=1) count anything, -P does nothing otherwise
+
+#define PROF_ERR(msg) Error_Raise(msg, 0, 0)
+
+// Lines of each part of the report
+#define EAST_PROFILE_TOP 20
+
+// Deepest call stack kept apart, deeper calls are counted as siblings of the last frame
+#define EAST_PROFILE_DEPTH 128
+
+// What a compiled code did, shared by every code compiled from the same string
+typedef struct prof_code_t {
+	// "script", "$x" or `="...` (the start of the string), with a copy of the string it came from for the positions
+	char label[24];
+	char *string;
+	size_t length;
+	size_t hash;
+	// Per pc, the code has ops of them
+	size_t ops;
+	unsigned char *opcodes;
+	pc_t *positions;
+	uint64_t *counts;
+	uint64_t *cycles;
+	// Times it was called by `=` or `$`
+	uint64_t calls;
+} prof_code_t;
+
+// A code running with a given call stack, the path from the root is the stack
+typedef struct prof_node_t {
+	prof_code_t *code;
+	struct prof_node_t *parent;
+	// Position on the code of the parent that called it
+	pc_t call;
+	size_t depth;
+	// Per pc of the code, like on prof_code_t
+	uint64_t *counts;
+	uint64_t *cycles;
+	struct prof_node_t **children;
+	size_t children_length;
+	size_t children_size;
+} prof_node_t;
+
+// Everything counted on a run
+typedef struct prof_t {
+	int timing;
+	// Count by call stack too, for Prof_Stacks
+	int stacks;
+	// Its children are the codes that ran first (the script), node is the running one and stack has its callers
+	prof_node_t *root;
+	prof_node_t *node;
+	prof_node_t **stack;
+	size_t stack_length;
+	size_t stack_size;
+	prof_code_t **codes;
+	size_t codes_length;
+	size_t codes_size;
+	// Per opcode
+	uint64_t op_counts[OP_COUNT];
+	uint64_t op_cycles[OP_COUNT];
+	// When the last instruction started and where its time goes, for timing
+	uint64_t last;
+	uint64_t *last_cycles;
+	uint64_t *last_stack_cycles;
+	unsigned char last_op;
+} prof_t;
+
+prof_t *Prof_Create(int timing, int stacks);
+void Prof_Delete(prof_t *P);
+
+// Record of the code E is running, made on the first use
+prof_code_t *Prof_Code(prof_t *P, East_State *E);
+
+// Count the instruction on pc of the code E is running, before it runs
+void Prof_Step(prof_t *P, East_State *E, pc_t pc);
+
+// E switched to the code of a `=` or `$` on pc of the caller (replacing it if tail), and back to the caller
+void Prof_Call(prof_t *P, East_State *E, pc_t pc, int tail);
+void Prof_Return(prof_t *P);
+
+// Print what was counted, sorted by cost, name is what the script is called on the positions
+void Prof_Report(prof_t *P, FILE *fp, const char *name);
+
+// Print the counts of every call stack in the collapsed format of flamegraph.pl, a line per instruction like
+// script:3:1;$a:1:4;="ab":1:1 120
+void Prof_Stacks(prof_t *P, FILE *fp, const char *name);
+
+#endif // EAST_PROFILE_H
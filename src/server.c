@@ -0,0 +1,258 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "server.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SERVER_ERR(msg) do {fprintf(stderr,"East, fatal error: %s\n", msg);exit(1);} while (0)
+
+// Status of a response
+#define SERVER_OK 0
+#define SERVER_FAILED 1
+#define SERVER_UNKNOWN 2
+
+// A compiled script, id is 0 on unused slots
+typedef struct {
+	size_t id;
+	size_t hash;
+	char *script;
+	size_t length;
+	east_script_t *compiled;
+} script_t;
+
+// Growable buffer for what a request carries
+typedef struct {
+	char *buffer;
+	size_t size;
+} request_t;
+
+// Same hash as the `=` cache (FNV-1a)
+static size_t ServerHash(const char *string, size_t length) {
+	size_t hash = 2166136261u;
+
+	for (size_t i = 0; i < length; i++)
+		hash = (hash ^ (unsigned char)string[i]) * (size_t)16777619u;
+
+	return hash;
+}
+
+// Read a number ended by the given character, returns 0 on EOF or on anything else
+static int ServerNumber(FILE *fp, size_t *n, int end) {
+	int c = getc(fp);
+
+	if (c < '0' || c > '9')
+		return 0;
+
+	*n = 0;
+	for (; c >= '0' && c <= '9'; c = getc(fp))
+		*n = *n*10 + (c - '0');
+
+	return c == end;
+}
+
+// Read length bytes into R (NUL terminated, like a mapped file)
+static char *ServerRead(FILE *fp, request_t *R, size_t length) {
+	if (length + 1 > R->size) {
+		char *tmp = realloc(R->buffer, length + 1);
+		if (!tmp)
+			SERVER_ERR("Out of memory");
+
+		R->buffer = tmp;
+		R->size = length + 1;
+	}
+
+	if (fread(R->buffer, 1, length, fp) != length)
+		SERVER_ERR("Request ended early");
+
+	R->buffer[length] = '\0';
+	return R->buffer;
+}
+
+// Find a script by contents, compiling it on a slot of its own if it isn't there
+static script_t *ServerCompile(script_t *scripts, size_t *next_id, east_t *engine, const char *string, size_t length) {
+	size_t hash = ServerHash(string, length);
+
+	for (size_t i = 0; i < EAST_SERVER_SCRIPTS; i++) {
+		script_t *S = &scripts[i];
+		if (S->id && S->hash == hash && S->length == length && memcmp(S->script, string, length) == 0)
+			return S;
+	}
+
+	// Ids only grow, so an id of a replaced script is unknown instead of meaning another one
+	size_t id = (*next_id)++;
+	script_t *S = &scripts[id % EAST_SERVER_SCRIPTS];
+
+	if (S->id) {
+		East_ScriptDelete(engine, S->compiled);
+		free(S->script);
+	}
+
+	S->script = malloc(length + 1);
+	if (!S->script)
+		SERVER_ERR("Out of memory");
+
+	memcpy(S->script, string, length);
+	S->script[length] = '\0';
+	S->length = length;
+	S->hash = hash;
+	// An error on the script is reported when running, only running out of memory fails here
+	S->compiled = East_Compile(engine, string, length, NULL);
+	if (!S->compiled)
+		SERVER_ERR("Out of memory");
+	S->id = id;
+
+	return S;
+}
+
+// Output of the engine, kept for the response
+static void ServerCollect(void *user, const char *string, size_t length) {
+	server_t *S = user;
+
+	if (S->length + length > S->size) {
+		size_t size = S->size ? S->size : 4096;
+		while (S->length + length > size)
+			size *= 2;
+
+		char *tmp = realloc(S->buffer, size);
+		if (!tmp)
+			SERVER_ERR("Out of memory");
+
+		S->buffer = tmp;
+		S->size = size;
+	}
+
+	memcpy(S->buffer + S->length, string, length);
+	S->length += length;
+}
+
+// Run a script on input, errors only stop this run
+static int ServerExecute(server_t *S, east_t *engine, script_t *script, east_mode_t mode, char *input, size_t input_length) {
+	east_error_t error;
+	int status = SERVER_OK;
+
+	if (East_Run(engine, script->compiled, mode, input, input_length, &error) != EAST_OK) {
+		status = SERVER_FAILED;
+		East_PrintError(&error, stderr);
+	}
+
+	// Same as a normal run
+	ServerCollect(S, "\n", 1);
+	return status;
+}
+
+void Server_Options(server_t *S, east_options_t *options) {
+	S->buffer = NULL;
+	S->length = 0;
+	S->size = 0;
+
+	options->write = ServerCollect;
+	options->user = S;
+	options->line_flush = 0;
+}
+
+int Server_Run(server_t *S, east_t *engine) {
+	script_t *scripts = calloc(EAST_SERVER_SCRIPTS, sizeof(script_t));
+	size_t next_id = 1;
+	request_t script = {NULL, 0};
+	request_t input = {NULL, 0};
+
+	if (!scripts)
+		SERVER_ERR("Out of memory");
+
+	// <mode> <script length> <input length>\n<script><input>, or <mode> @<id> <input length>\n<input>
+	for (int c; (c = getc(stdin)) != EOF;) {
+		east_mode_t mode;
+		switch (c) {
+			case 'c':
+				mode = EAST_MODE_CHAR;
+				break;
+			case 'f':
+				mode = EAST_MODE_FLOAT;
+				break;
+			case 'd':
+				mode = EAST_MODE_DOUBLE;
+				break;
+			case 'i':
+				mode = EAST_MODE_INT;
+				break;
+			case 'l':
+				mode = EAST_MODE_LONG;
+				break;
+			default:
+				SERVER_ERR("Unknown mode on request");
+		}
+
+		if (getc(stdin) != ' ')
+			SERVER_ERR("Malformed request");
+
+		int cached = (c = getc(stdin)) == '@';
+		if (!cached)
+			ungetc(c, stdin);
+
+		size_t id = 0;
+		size_t script_length = 0;
+		size_t input_length = 0;
+
+		if (!ServerNumber(stdin, cached ? &id : &script_length, ' ') || !ServerNumber(stdin, &input_length, '\n'))
+			SERVER_ERR("Malformed request");
+
+		script_t *found = NULL;
+
+		if (cached) {
+			found = &scripts[id % EAST_SERVER_SCRIPTS];
+			if (found->id != id || id == 0)
+				found = NULL;
+		} else {
+			ServerRead(stdin, &script, script_length);
+			found = ServerCompile(scripts, &next_id, engine, script.buffer, script_length);
+		}
+
+		ServerRead(stdin, &input, input_length);
+
+		// Tell the client to send the script again
+		int status = SERVER_UNKNOWN;
+		S->length = 0;
+
+		if (found)
+			status = ServerExecute(S, engine, found, mode, input.buffer, input_length);
+
+		// <status> <id> <output length>\n<output>
+		printf("%i %zu %zu\n", status, found ? found->id : id, S->length);
+		fwrite(S->buffer, 1, S->length, stdout);
+		fflush(stdout);
+		S->length = 0;
+	}
+
+	for (size_t i = 0; i < EAST_SERVER_SCRIPTS; i++) {
+		if (scripts[i].id) {
+			East_ScriptDelete(engine, scripts[i].compiled);
+			free(scripts[i].script);
+		}
+	}
+
+	free(scripts);
+	free(script.buffer);
+	free(input.buffer);
+	free(S->buffer);
+	S->buffer = NULL;
+	S->size = 0;
+
+	return 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef EAST_SERVER_H
+#define EAST_SERVER_H
+
+#include "libeast.h"
+
+// Number of compiled scripts the server keeps, the oldest one is replaced when a new one doesn't fit
+#define EAST_SERVER_SCRIPTS 256
+
+// Output of the running request, collected to be sent with its length
+typedef struct {
+	char *buffer;
+	size_t length;
+	size_t size;
+} server_t;
+
+// Make an engine created with options write to the responses of S
+void Server_Options(server_t *S, east_options_t *options);
+
+// Serve requests from standard input until it ends, answering on standard output (see the README for the format)
+// The engine has to be created with the options from Server_Options
+// Scripts are compiled once and kept by contents, errors only fail their request, returns the exit status
+int Server_Run(server_t *S, east_t *engine);
+
+#endif // EAST_SERVER_H
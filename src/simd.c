@@ -0,0 +1,308 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "simd.h"
+
+// Bytes of an AVX2 vector, reductions use this many bytes of lanes on every CPU
+#define SIMD_BYTES 32
+
+// Slot of the bottommost of the n topmost items, and how many of them come before the ring wraps (the rest start at slot 0)
+static size_t SimdStart(const data_t *D, size_t n, size_t *first) {
+	size_t start = D->reversed ? D->head : (D->head + D->length - n) & (D->size - 1);
+
+	*first = D->size - start;
+	if (*first > n)
+		*first = n;
+
+	return start;
+}
+
+#ifdef EAST_SIMD
+#include <immintrin.h>
+
+// Only called if the CPU has AVX2, the rest of the file keeps to SSE2 (which every x86-64 CPU has)
+#define SIMD_AVX2 __attribute__((target("avx2")))
+
+static int SimdAVX2() {
+#ifdef EAST_NO_AVX2
+	return 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// Clear the upper halves of the registers after AVX2 code, or the SSE code after it slows down
+// Compilers only do it on their own when optimizing for speed
+SIMD_AVX2 static size_t SimdDone(size_t result) {
+	_mm256_zeroupper();
+	return result;
+}
+
+#define SIMD_KERNEL(name, ...) (SimdAVX2() ? SimdDone(MODE_NAME(name##AVX2)(__VA_ARGS__)) : MODE_NAME(name##SSE2)(__VA_ARGS__))
+
+// Loads and stores of W items, and a bit for each NUL among them
+#define LOAD_SSE2C(p) _mm_loadu_si128((const __m128i*)(p))
+#define LOAD_AVX2C(p) _mm256_loadu_si256((const __m256i*)(p))
+#define STORE_SSE2C(p, v) _mm_storeu_si128((__m128i*)(p), v)
+#define STORE_AVX2C(p, v) _mm256_storeu_si256((__m256i*)(p), v)
+
+#define MASK_SSE2C(p) _mm_movemask_epi8(_mm_cmpeq_epi8(LOAD_SSE2C(p), _mm_setzero_si128()))
+#define MASK_AVX2C(p) _mm256_movemask_epi8(_mm256_cmpeq_epi8(LOAD_AVX2C(p), _mm256_setzero_si256()))
+#define MASK_SSE2F(p) _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(p), _mm_setzero_ps()))
+#define MASK_AVX2F(p) _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(p), _mm256_setzero_ps(), _CMP_EQ_OQ))
+#define MASK_SSE2D(p) _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(p), _mm_setzero_pd()))
+#define MASK_AVX2D(p) _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p), _mm256_setzero_pd(), _CMP_EQ_OQ))
+
+// Signed bytes, SSE2 only compares them unsigned
+#define SIGN_SSE2C(v) _mm_xor_si128(v, _mm_set1_epi8((char)0x80))
+#define MIN_SSE2C(a, b) SIGN_SSE2C(_mm_min_epu8(SIGN_SSE2C(a), SIGN_SSE2C(b)))
+#define MAX_SSE2C(a, b) SIGN_SSE2C(_mm_max_epu8(SIGN_SSE2C(a), SIGN_SSE2C(b)))
+
+// The first NUL from the start (SimdFind) or the end (SimdFindBack), W items at a time
+// Return where it is (after it going backwards) or where they stopped looking
+#define SIMD_FIND(ISA, S, ATTR, T, W) \
+	ATTR static size_t SimdFind##ISA##S(const T *x, size_t n) { \
+		size_t i = 0; \
+		for (; i + (W) <= n; i += (W)) { \
+			unsigned mask = MASK_##ISA##S(x + i); \
+			if (mask) \
+				return i + __builtin_ctz(mask); \
+		} \
+		return i; \
+	} \
+	ATTR static size_t SimdFindBack##ISA##S(const T *x, size_t n) { \
+		size_t i = n; \
+		for (; i >= (W); i -= (W)) { \
+			unsigned mask = MASK_##ISA##S(x + i - (W)); \
+			if (mask) \
+				return i - (W) + (32 - __builtin_clz(mask)); \
+		} \
+		return i; \
+	}
+
+// Reduce blocks of SIMD_BYTES bytes into the lanes (as SIMD_BYTES/(W*sizeof(T)) vectors), return how many items went in
+#define SIMD_LANES(ISA, S, ATTR, T, V, W, LOAD, STORE, ADD, MIN, MAX) \
+	ATTR static size_t SimdLanes##ISA##S(T *acc, const T *x, size_t n, simd_op_t op) { \
+		enum { LANES = SIMD_BYTES/sizeof(T), VECTORS = LANES/(W) }; \
+		size_t bulk = n - n % LANES; \
+		V r[VECTORS]; \
+		if (!bulk) \
+			return 0; \
+		for (size_t k = 0; k < VECTORS; k++) \
+			r[k] = LOAD(x + k*(W)); \
+		for (size_t i = LANES; i < bulk; i += LANES) { \
+			for (size_t k = 0; k < VECTORS; k++) { \
+				V v = LOAD(x + i + k*(W)); \
+				r[k] = (op == SIMD_MIN) ? MIN(v, r[k]) : (op == SIMD_MAX) ? MAX(v, r[k]) : ADD(r[k], v); \
+			} \
+		} \
+		for (size_t k = 0; k < VECTORS; k++) \
+			STORE(acc + k*(W), r[k]); \
+		return bulk; \
+	}
+
+// Replace the items with item op a, return how many were done
+#define SIMD_MAP(ISA, S, ATTR, T, V, W, LOAD, STORE, SET1, ADD, SUB, MUL, DIV) \
+	ATTR static size_t SimdMap##ISA##S(T *x, size_t n, simd_op_t op, T a) { \
+		V va = SET1(a); \
+		size_t i = 0; \
+		switch (op) { \
+			case SIMD_ADD: \
+				for (; i + (W) <= n; i += (W)) STORE(x + i, ADD(LOAD(x + i), va)); \
+				break; \
+			case SIMD_SUB: \
+				for (; i + (W) <= n; i += (W)) STORE(x + i, SUB(LOAD(x + i), va)); \
+				break; \
+			case SIMD_MULT: \
+				for (; i + (W) <= n; i += (W)) STORE(x + i, MUL(LOAD(x + i), va)); \
+				break; \
+			case SIMD_DIV: \
+				for (; i + (W) <= n; i += (W)) STORE(x + i, DIV(LOAD(x + i), va)); \
+				break; \
+			default: \
+				break; \
+		} \
+		return i; \
+	}
+
+// Bytes multiplied as 16 bit pairs, the even ones on the low half and the odd ones shifted down
+#define MUL_SSE2C(v, a) _mm_or_si128(_mm_and_si128(_mm_mullo_epi16(v, a), _mm_set1_epi16(0xFF)), _mm_slli_epi16(_mm_mullo_epi16(_mm_srli_epi16(v, 8), a), 8))
+#define MUL_AVX2C(v, a) _mm256_or_si256(_mm256_and_si256(_mm256_mullo_epi16(v, a), _mm256_set1_epi16(0xFF)), _mm256_slli_epi16(_mm256_mullo_epi16(_mm256_srli_epi16(v, 8), a), 8))
+
+// There is no vector integer division, the loop divides chars
+#define DIV_NONE(v, a) (v)
+#define SIMD_MAPC(ISA, ATTR, V, W, SET1, ADD, SUB) \
+	SIMD_MAP(ISA, CMap, ATTR, char, V, W, LOAD_##ISA##C, STORE_##ISA##C, SET1, ADD, SUB, MUL_##ISA##C, DIV_NONE) \
+	ATTR static size_t SimdMap##ISA##C(char *x, size_t n, simd_op_t op, char a) { \
+		return (op == SIMD_DIV) ? 0 : SimdMap##ISA##CMap(x, n, op, a); \
+	}
+
+// char
+SIMD_FIND(SSE2, C, , char, 16)
+SIMD_FIND(AVX2, C, SIMD_AVX2, char, 32)
+SIMD_LANES(SSE2, C, , char, __m128i, 16, LOAD_SSE2C, STORE_SSE2C, _mm_add_epi8, MIN_SSE2C, MAX_SSE2C)
+SIMD_LANES(AVX2, C, SIMD_AVX2, char, __m256i, 32, LOAD_AVX2C, STORE_AVX2C, _mm256_add_epi8, _mm256_min_epi8, _mm256_max_epi8)
+SIMD_MAPC(SSE2, , __m128i, 16, _mm_set1_epi8, _mm_add_epi8, _mm_sub_epi8)
+SIMD_MAPC(AVX2, SIMD_AVX2, __m256i, 32, _mm256_set1_epi8, _mm256_add_epi8, _mm256_sub_epi8)
+
+// float
+SIMD_FIND(SSE2, F, , float, 4)
+SIMD_FIND(AVX2, F, SIMD_AVX2, float, 8)
+SIMD_LANES(SSE2, F, , float, __m128, 4, _mm_loadu_ps, _mm_storeu_ps, _mm_add_ps, _mm_min_ps, _mm_max_ps)
+SIMD_LANES(AVX2, F, SIMD_AVX2, float, __m256, 8, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_add_ps, _mm256_min_ps, _mm256_max_ps)
+SIMD_MAP(SSE2, F, , float, __m128, 4, _mm_loadu_ps, _mm_storeu_ps, _mm_set1_ps, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, _mm_div_ps)
+SIMD_MAP(AVX2, F, SIMD_AVX2, float, __m256, 8, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_set1_ps, _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps, _mm256_div_ps)
+
+// double
+SIMD_FIND(SSE2, D, , double, 2)
+SIMD_FIND(AVX2, D, SIMD_AVX2, double, 4)
+SIMD_LANES(SSE2, D, , double, __m128d, 2, _mm_loadu_pd, _mm_storeu_pd, _mm_add_pd, _mm_min_pd, _mm_max_pd)
+SIMD_LANES(AVX2, D, SIMD_AVX2, double, __m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_add_pd, _mm256_min_pd, _mm256_max_pd)
+SIMD_MAP(SSE2, D, , double, __m128d, 2, _mm_loadu_pd, _mm_storeu_pd, _mm_set1_pd, _mm_add_pd, _mm_sub_pd, _mm_mul_pd, _mm_div_pd)
+SIMD_MAP(AVX2, D, SIMD_AVX2, double, __m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_set1_pd, _mm256_add_pd, _mm256_sub_pd, _mm256_mul_pd, _mm256_div_pd)
+
+// int32_t, SSE2 has no 32 bit multiplication, minimum or maximum, so they are made of what it has
+#define MASK_SSE2I(p) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(LOAD_SSE2C(p), _mm_setzero_si128())))
+#define MASK_AVX2I(p) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(LOAD_AVX2C(p), _mm256_setzero_si256())))
+
+static __m128i SimdSelectSSE2(__m128i mask, __m128i a, __m128i b) {
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+#define MIN_SSE2I(a, b) SimdSelectSSE2(_mm_cmplt_epi32(a, b), a, b)
+#define MAX_SSE2I(a, b) SimdSelectSSE2(_mm_cmpgt_epi32(a, b), a, b)
+
+// Low halves of the products of the even and the odd items, put back in order
+static __m128i SimdMulSSE2I(__m128i v, __m128i a) {
+	__m128i even = _mm_mul_epu32(v, a);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(v, 32), _mm_srli_epi64(a, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// int64_t, a 64 bit item is NUL if both of its halves are
+static unsigned SimdMaskSSE2L(const int64_t *p) {
+	__m128i zero = _mm_cmpeq_epi32(LOAD_SSE2C(p), _mm_setzero_si128());
+	return _mm_movemask_pd(_mm_castsi128_pd(_mm_and_si128(zero, _mm_shuffle_epi32(zero, _MM_SHUFFLE(2, 3, 0, 1)))));
+}
+
+#define MASK_SSE2L(p) SimdMaskSSE2L(p)
+#define MASK_AVX2L(p) _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(LOAD_AVX2C(p), _mm256_setzero_si256())))
+
+// AVX2 compares 64 bit items, SSE2 leaves the minimum and maximum to the loop
+#define MIN_AVX2L(a, b) _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b))
+#define MAX_AVX2L(a, b) _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b))
+
+// Integer maps without division (nor 64 bit multiplication, which needs AVX-512), the loop does those
+#define SIMD_MAPI(ISA, S, ATTR, T, V, W, SET1, ADD, SUB, MUL, HAS_MUL) \
+	SIMD_MAP(ISA, S##Map, ATTR, T, V, W, LOAD_##ISA##C, STORE_##ISA##C, SET1, ADD, SUB, MUL, DIV_NONE) \
+	ATTR static size_t SimdMap##ISA##S(T *x, size_t n, simd_op_t op, T a) { \
+		return (op == SIMD_DIV || (op == SIMD_MULT && !(HAS_MUL))) ? 0 : SimdMap##ISA##S##Map(x, n, op, a); \
+	}
+
+// int32_t
+SIMD_FIND(SSE2, I, , int32_t, 4)
+SIMD_FIND(AVX2, I, SIMD_AVX2, int32_t, 8)
+SIMD_LANES(SSE2, I, , int32_t, __m128i, 4, LOAD_SSE2C, STORE_SSE2C, _mm_add_epi32, MIN_SSE2I, MAX_SSE2I)
+SIMD_LANES(AVX2, I, SIMD_AVX2, int32_t, __m256i, 8, LOAD_AVX2C, STORE_AVX2C, _mm256_add_epi32, _mm256_min_epi32, _mm256_max_epi32)
+SIMD_MAPI(SSE2, I, , int32_t, __m128i, 4, _mm_set1_epi32, _mm_add_epi32, _mm_sub_epi32, SimdMulSSE2I, 1)
+SIMD_MAPI(AVX2, I, SIMD_AVX2, int32_t, __m256i, 8, _mm256_set1_epi32, _mm256_add_epi32, _mm256_sub_epi32, _mm256_mullo_epi32, 1)
+
+// int64_t
+SIMD_FIND(SSE2, L, , int64_t, 2)
+SIMD_FIND(AVX2, L, SIMD_AVX2, int64_t, 4)
+SIMD_LANES(SSE2, LSum, , int64_t, __m128i, 2, LOAD_SSE2C, STORE_SSE2C, _mm_add_epi64, DIV_NONE, DIV_NONE)
+SIMD_LANES(AVX2, L, SIMD_AVX2, int64_t, __m256i, 4, LOAD_AVX2C, STORE_AVX2C, _mm256_add_epi64, MIN_AVX2L, MAX_AVX2L)
+SIMD_MAPI(SSE2, L, , int64_t, __m128i, 2, _mm_set1_epi64x, _mm_add_epi64, _mm_sub_epi64, DIV_NONE, 0)
+SIMD_MAPI(AVX2, L, SIMD_AVX2, int64_t, __m256i, 4, _mm256_set1_epi64x, _mm256_add_epi64, _mm256_sub_epi64, DIV_NONE, 0)
+
+static size_t SimdLanesSSE2L(int64_t *acc, const int64_t *x, size_t n, simd_op_t op) {
+	return (op == SIMD_SUM) ? SimdLanesSSE2LSum(acc, x, n, op) : 0;
+}
+
+// The first byte of s that is in the set (of up to SIMD_SET bytes), W bytes at a time, or where it stopped looking
+#define SIMD_SCAN(ISA, ATTR, V, W, LOAD, SET1, EQ, OR, ZERO, MOVEMASK) \
+	ATTR static size_t SimdScan##ISA(const char *s, size_t n, const char *set, size_t length) { \
+		V bytes[SIMD_SET]; \
+		size_t i = 0; \
+		for (size_t k = 0; k < length; k++) \
+			bytes[k] = SET1(set[k]); \
+		for (; i + (W) <= n; i += (W)) { \
+			V v = LOAD(s + i); \
+			V hits = ZERO(); \
+			for (size_t k = 0; k < length; k++) \
+				hits = OR(hits, EQ(v, bytes[k])); \
+			unsigned mask = MOVEMASK(hits); \
+			if (mask) \
+				return i + __builtin_ctz(mask); \
+		} \
+		return i; \
+	}
+
+SIMD_SCAN(SSE2, , __m128i, 16, LOAD_SSE2C, _mm_set1_epi8, _mm_cmpeq_epi8, _mm_or_si128, _mm_setzero_si128, _mm_movemask_epi8)
+SIMD_SCAN(AVX2, SIMD_AVX2, __m256i, 32, LOAD_AVX2C, _mm256_set1_epi8, _mm256_cmpeq_epi8, _mm256_or_si256, _mm256_setzero_si256, _mm256_movemask_epi8)
+#endif // EAST_SIMD
+
+size_t Simd_Scan(const char *s, size_t n, const char *set, size_t length) {
+	size_t i = 0;
+
+	// Comparing with every byte of a big set costs more than looking each byte up
+	if (length > SIMD_SET) {
+		unsigned char table[256] = {0};
+		for (size_t k = 0; k < length; k++)
+			table[(unsigned char)set[k]] = 1;
+
+		while (i < n && !table[(unsigned char)s[i]])
+			i++;
+		return i;
+	}
+
+	if (length == 0)
+		return n;
+
+#ifdef EAST_SIMD
+	i = SimdAVX2() ? SimdDone(SimdScanAVX2(s, n, set, length)) : SimdScanSSE2(s, n, set, length);
+#endif
+	while (i < n && !memchr(set, s[i], length))
+		i++;
+	return i;
+}
+
+#define MODE_S C
+#define MODE_T char
+#define MODE_W int
+#include "simdmode.h"
+
+#define MODE_S F
+#define MODE_T float
+#define MODE_W float
+#include "simdmode.h"
+
+#define MODE_S D
+#define MODE_T double
+#define MODE_W double
+#include "simdmode.h"
+
+#define MODE_S I
+#define MODE_T int32_t
+#define MODE_W uint32_t
+#include "simdmode.h"
+
+#define MODE_S L
+#define MODE_T int64_t
+#define MODE_W uint64_t
+#include "simdmode.h"
@@ -0,0 +1,75 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef EAST_SIMD_H
+#define EAST_SIMD_H
+
+#include <limits.h>
+
+#include "data.h"
+
+// SSE2 or AVX2 kernels (whichever the CPU has) on x86-64, plain loops elsewhere or if EAST_NO_SIMD is defined
+#if defined(__GNUC__) && defined(__x86_64__) && CHAR_MIN < 0 && !defined(EAST_NO_SIMD)
+#define EAST_SIMD
+#endif
+
+// What a `|` instruction does with the segment (the items above the topmost NUL), in the order of Simd_Ops
+typedef enum {
+	SIMD_ADD,
+	SIMD_SUB,
+	SIMD_MULT,
+	SIMD_DIV,
+	SIMD_SUM,
+	SIMD_MIN,
+	SIMD_MAX,
+	SIMD_ITEMS,
+	SIMD_FIND,
+	SIMD_ANY
+} simd_op_t;
+
+// The character after `|` for each operation
+#define SIMD_OPS "+-*/s<>cfa"
+
+// Sets up to this size are searched for with vectors, bigger ones with a table
+#define SIMD_SET 8
+
+// How many items are above the topmost NUL, all of them if there is none
+size_t Simd_SegmentC(const data_t *D);
+size_t Simd_SegmentF(const data_t *D);
+size_t Simd_SegmentD(const data_t *D);
+size_t Simd_SegmentI(const data_t *D);
+size_t Simd_SegmentL(const data_t *D);
+
+// Replace each of the n topmost items with item op a, as the math instructions do (dividing by 1 instead of 0)
+void Simd_MapC(data_t *D, size_t n, simd_op_t op, char a);
+void Simd_MapF(data_t *D, size_t n, simd_op_t op, float a);
+void Simd_MapD(data_t *D, size_t n, simd_op_t op, double a);
+void Simd_MapI(data_t *D, size_t n, simd_op_t op, int32_t a);
+void Simd_MapL(data_t *D, size_t n, simd_op_t op, int64_t a);
+
+// Sum, minimum or maximum of the n topmost items (at least one)
+char Simd_ReduceC(const data_t *D, size_t n, simd_op_t op);
+float Simd_ReduceF(const data_t *D, size_t n, simd_op_t op);
+double Simd_ReduceD(const data_t *D, size_t n, simd_op_t op);
+int32_t Simd_ReduceI(const data_t *D, size_t n, simd_op_t op);
+int64_t Simd_ReduceL(const data_t *D, size_t n, simd_op_t op);
+
+// Index of the first of the n bytes of s that is one of the length bytes of set, n if there is none
+size_t Simd_Scan(const char *s, size_t n, const char *set, size_t length);
+
+#endif // EAST_SIMD_H
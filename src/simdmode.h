@@ -0,0 +1,170 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Segment operations for a single mode, included by simd.c once per mode
+// Expects MODE_S (suffix), MODE_T (type) and MODE_W (type of the math) to be defined, and the kernels of the mode if EAST_SIMD is, no header guard on purpose
+// The kernels do as much as they can and leave the rest of the items to the loops here
+
+#define LANES (SIMD_BYTES/sizeof(MODE_T))
+
+// One step of a reduction, what the vector min and max do too
+static MODE_T MODE_NAME(SimdStep)(MODE_T acc, MODE_T x, simd_op_t op) {
+	switch (op) {
+		case SIMD_MIN:
+			return (x < acc) ? x : acc;
+		case SIMD_MAX:
+			return (x > acc) ? x : acc;
+		default:
+			return MODE_ADD(acc, x);
+	}
+}
+
+// Index of the first NUL of the n items (or the last one if backwards), n if there is none
+static size_t MODE_NAME(SimdFind)(const MODE_T *x, size_t n, int backwards) {
+	size_t i;
+
+	if (backwards) {
+		// The kernel stops right after the NUL, or leaves the items before i unchecked
+#ifdef EAST_SIMD
+		i = SIMD_KERNEL(SimdFindBack, x, n);
+#else
+		i = n;
+#endif
+		while (i > 0 && x[i-1] != 0)
+			i--;
+		return i ? i-1 : n;
+	}
+
+#ifdef EAST_SIMD
+	i = SIMD_KERNEL(SimdFind, x, n);
+#else
+	i = 0;
+#endif
+	while (i < n && x[i] != 0)
+		i++;
+	return i;
+}
+
+static void MODE_NAME(SimdMapItems)(MODE_T *x, size_t n, simd_op_t op, MODE_T a) {
+#ifdef EAST_SIMD
+	size_t i = SIMD_KERNEL(SimdMap, x, n, op, a);
+#else
+	size_t i = 0;
+#endif
+
+	switch (op) {
+		case SIMD_ADD:
+			for (; i < n; i++) x[i] = MODE_ADD(x[i], a);
+			break;
+		case SIMD_SUB:
+			for (; i < n; i++) x[i] = MODE_SUB(x[i], a);
+			break;
+		case SIMD_MULT:
+			for (; i < n; i++) x[i] = MODE_MULT(x[i], a);
+			break;
+		case SIMD_DIV:
+			for (; i < n; i++) x[i] = MODE_DIV(x[i], a);
+			break;
+		default:
+			break;
+	}
+}
+
+// Each of the LANES lanes reduces the items on its position of every block of LANES items, then the lanes and whatever didn't fill a block are reduced in order
+// Floating point sums depend on the order, so the scalar loop does it the same way as the kernels
+static MODE_T MODE_NAME(SimdReduceItems)(const MODE_T *x, size_t n, simd_op_t op) {
+	MODE_T acc[LANES];
+
+#ifdef EAST_SIMD
+	size_t bulk = SIMD_KERNEL(SimdLanes, acc, x, n, op);
+#else
+	size_t bulk = n - n % LANES;
+	for (size_t j = 0; j < LANES && bulk; j++)
+		acc[j] = x[j];
+	for (size_t i = LANES; i < bulk; i += LANES) {
+		for (size_t j = 0; j < LANES; j++)
+			acc[j] = MODE_NAME(SimdStep)(acc[j], x[i+j], op);
+	}
+#endif
+
+	size_t i = 1;
+	MODE_T r = x[0];
+
+	if (bulk) {
+		r = acc[0];
+		for (size_t j = 1; j < LANES; j++)
+			r = MODE_NAME(SimdStep)(r, acc[j], op);
+		i = bulk;
+	}
+
+	for (; i < n; i++)
+		r = MODE_NAME(SimdStep)(r, x[i], op);
+	return r;
+}
+
+size_t MODE_NAME(Simd_Segment)(const data_t *D) {
+	const MODE_T *items = D->items;
+	size_t first = D->size - D->head;
+	if (first > D->length)
+		first = D->length;
+	size_t second = D->length - first;
+
+	// The items take the slots from the head on and, if they wrap, the ones from 0
+	// Reversed, the top is at the head, so going down the data goes forward on memory
+	if (D->reversed) {
+		size_t i = MODE_NAME(SimdFind)(items + D->head, first, 0);
+		if (i < first)
+			return i;
+		return first + MODE_NAME(SimdFind)(items, second, 0);
+	}
+
+	size_t i = MODE_NAME(SimdFind)(items, second, 1);
+	if (i < second)
+		return second - 1 - i;
+
+	i = MODE_NAME(SimdFind)(items + D->head, first, 1);
+	return second + ((i < first) ? first - 1 - i : first);
+}
+
+void MODE_NAME(Simd_Map)(data_t *D, size_t n, simd_op_t op, MODE_T a) {
+	MODE_T *items = D->items;
+	size_t first;
+	size_t start = SimdStart(D, n, &first);
+
+	if (op == SIMD_DIV && a == 0)
+		a = 1;
+
+	MODE_NAME(SimdMapItems)(items + start, first, op, a);
+	MODE_NAME(SimdMapItems)(items, n - first, op, a);
+}
+
+MODE_T MODE_NAME(Simd_Reduce)(const data_t *D, size_t n, simd_op_t op) {
+	const MODE_T *items = D->items;
+	size_t first;
+	size_t start = SimdStart(D, n, &first);
+
+	MODE_T r = MODE_NAME(SimdReduceItems)(items + start, first, op);
+	if (n > first)
+		r = MODE_NAME(SimdStep)(r, MODE_NAME(SimdReduceItems)(items, n - first, op), op);
+	return r;
+}
+
+#undef LANES
+#undef MODE_S
+#undef MODE_T
+#undef MODE_W
@@ -16,65 +16,40 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
-#include "util.h"
-
-// Read an entire file into a variable
-char *ReadFile(size_t *length, FILE *fp) {
-	size_t read_length;
-	size_t file_length;
-
-	// Get file length
-	fseek(fp, 0, SEEK_END);
-	file_length = ftell(fp);
-	fseek(fp, 0, SEEK_SET);
-
-	if (file_length > EAST_FILESIZE_LIMIT) {
-		EAST_ERR("File too large");
-	}
+// fileno, fstat, read, mmap and posix_madvise are POSIX
+#define _POSIX_C_SOURCE 200112L
 
-	// Make space for the contents and handle OOM
-	char *contents = malloc(file_length+1);
-
-	if (!contents)
-		EAST_ERR("Out of memory");
-
-	// Read the entire file and handle errors
-	read_length = fread(contents, 1, file_length, fp);
-
-	if (file_length != read_length) {
-		free(contents);
-		EAST_ERR("Error on file read");
-	}
+#include "util.h"
 
-	// NUL terminate the string and remove ending newline
-	contents[file_length] = '\0';
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
 
-	if (contents[file_length-1] == '\n') {
-		file_length--;
-		contents[file_length] = '\0';
-	}
+// Size of the buffer when the size of what is being read isn't known
+#define EAST_READ_BLOCK 65536
 
-	*length = file_length;
+// Read everything left on a file descriptor with big read(2) calls, growing the buffer geometrically
+static char *ReadFd(size_t *length, int fd) {
+	struct stat st;
+	size_t size = EAST_READ_BLOCK;
 
-	return contents;
-}
+	// Regular files know their size, so one allocation is usually enough (the extra byte is for seeing the EOF)
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+		size = st.st_size + 1;
 
-// Read the entirety of stdin on a single variable
-char *ReadStdin(size_t *length) {
-	size_t str_size = 10;
 	size_t str_length = 0;
-	char *contents = calloc(str_size+1, sizeof(char));
-
-	int c = '\0';
+	char *contents = malloc(size+1);
 
-	// Read char by char
-	while (c != EOF) {
-		c = getchar();
+	if (!contents)
+		EAST_ERR("Out of memory");
 
+	while (1) {
 		// Handle reallocation
-		if (str_length+1 > str_size) {
-			str_size *= 2;
-			char *tmp = realloc(contents, (str_size+1) * sizeof(char));
+		if (str_length == size) {
+			size *= 2;
+			char *tmp = realloc(contents, size+1);
 			if (!tmp) {
 				free(contents);
 				EAST_ERR("Out of memory");
@@ -82,17 +57,25 @@ char *ReadStdin(size_t *length) {
 			contents = tmp;
 		}
 
-		// Append the character
-		contents[str_length] = (char)c;
-		str_length++;
+		ssize_t got = read(fd, contents + str_length, size - str_length);
+
+		if (got == 0)
+			break;
+
+		if (got < 0) {
+			if (errno == EINTR)
+				continue;
+			free(contents);
+			EAST_ERR("Error on file read");
+		}
+
+		str_length += got;
 	}
 
-	// Position over EOF and NUL terminate it
-	str_length--;
+	// NUL terminate it and remove ending newline if any
 	contents[str_length] = '\0';
 
-	// Remove ending newline if any
-	if (contents[str_length-1] == '\n') {
+	if (str_length > 0 && contents[str_length-1] == '\n') {
 		str_length--;
 		contents[str_length] = '\0';
 	}
@@ -100,3 +83,39 @@ char *ReadStdin(size_t *length) {
 	*length = str_length;
 	return contents;
 }
+
+// Read an entire file into a variable, the length is needed as it may contain NUL characters
+char *ReadFile(size_t *length, FILE *fp) {
+	return ReadFd(length, fileno(fp));
+}
+
+// Map a file read only instead of reading it, so execution starts without copying it and pages are only loaded when used
+// Files that can't be mapped (pipes, for example) are read as usual
+char *MapFile(size_t *length, FILE *fp) {
+	struct stat st;
+
+	if (fstat(fileno(fp), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+		return ReadFile(length, fp);
+
+	size_t file_length = st.st_size;
+	char *contents = mmap(NULL, file_length, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+
+	if (contents == MAP_FAILED)
+		return ReadFile(length, fp);
+
+	// Input is mostly read front to back, let the kernel read ahead
+	posix_madvise(contents, file_length, POSIX_MADV_SEQUENTIAL);
+
+	// The mapping can't be written, so the ending newline is removed only from the length
+	if (contents[file_length-1] == '\n')
+		file_length--;
+
+	*length = file_length;
+
+	return contents;
+}
+
+// Read the entirety of stdin on a single variable
+char *ReadStdin(size_t *length) {
+	return ReadFd(length, STDIN_FILENO);
+}
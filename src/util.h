@@ -20,13 +20,13 @@
 #define EAST_UTIL_H
 
 #define EAST_ERR(msg) do {fprintf(stderr,"East: %s\n", msg); exit(1);} while(0)
-#define EAST_FILESIZE_LIMIT 1073741824 // 1 GiB
 
 #include <stdlib.h>
 #include <stdio.h>
 
 // Exported functions
 char *ReadFile(size_t *length, FILE *fp);
+char *MapFile(size_t *length, FILE *fp);
 char *ReadStdin(size_t *length);
 
 #endif // EAST_UTIL_H
@@ -53,7 +53,7 @@ void WP_Push(wp_t *W, size_t waypoint) {
 
 	W->items[W->length] = waypoint;
 	W->length++;
-	W->items[W->length+1] = 0;
+	W->items[W->length] = 0;
 }
 
 size_t WP_Pop(wp_t *W) {
@@ -23,7 +23,9 @@
 #include <stdlib.h>
 #include <assert.h>
 
-#define WP_ERR(msg) do {fprintf(stderr,"East, fatal error: %s", msg);exit(1);} while (0)
+#include "error.h"
+
+#define WP_ERR(msg) Error_Raise(msg, 0, 0)
 
 typedef struct {
 	size_t *items;
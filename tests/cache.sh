@@ -0,0 +1,39 @@
+#!/bin/sh
+# Check that `=` compiles a string once and reuses it while the contents stay the same, by the counters of -s
+# Usage: tests/cache.sh [path/to/east]
+
+. "$(dirname "$0")/common.sh"
+
+# The `=` line of the statistics
+cache() {
+	echo "$err" | grep '`=` cache'
+}
+
+# The same string three times compiles once, on every mode and on the interpreter, the JIT and without fusing
+for flags in c f d i l cJ iJ cu; do
+	run '' -ns$flags '\0\,a===&:'
+	expect "-$flags same string" "$(cache)" ' `=` cache: 2 hits, 1 misses'
+	expect "-$flags same string output" "$(echo "$out" | sed 's/\.0*$//')" 97
+done
+
+# Two strings, each one compiled once
+run '' -ns '\0\,a=\0\,c==:'
+expect "two strings" "$(cache)" ' `=` cache: 1 hits, 2 misses'
+expect "two strings output" "$out" 99
+
+# A string changed in place is compiled again
+run '' -ns '\0\,a=,\c=:'
+expect "changed string" "$(cache)" ' `=` cache: 0 hits, 2 misses'
+expect "changed string output" "$out" 99
+
+# A string that grows every time it runs never hits
+run '' -ns '\0\&==={;}'
+expect "growing string" "$(cache)" ' `=` cache: 0 hits, 3 misses'
+expect "growing string output" "$out" '&&&&&&&&'
+
+# Once per character of the input
+run 'wxyz' -s '[\0\,a=,,,>]'
+expect "input loop" "$(cache)" ' `=` cache: 3 hits, 1 misses'
+expect "input loop exit code" "$code" 0
+
+finish
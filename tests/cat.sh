@@ -0,0 +1,52 @@
+#!/bin/sh
+# Check that examples/cat.east copies big inputs byte for byte, read from a pipe, a redirected file and a file argument
+# Usage: tests/cat.sh [path/to/east]
+
+. "$(dirname "$0")/common.sh"
+
+CAT="$(dirname "$0")/../examples/cat.east"
+
+# Every byte once, NUL included
+i=0
+: >"$TMP.bytes"
+
+while [ $i -lt 256 ]; do
+	printf "\\$(printf '%03o' $i)" >>"$TMP.bytes"
+	i=$((i+1))
+done
+
+# input size, the bytes repeated up to the size, ending with the newline East ends its output with
+input() {
+	: >"$TMP.in"
+
+	while [ $(wc -c <"$TMP.in") -lt $1 ]; do
+		cat "$TMP.bytes" "$TMP.in" "$TMP.in" >"$TMP.more"
+		mv "$TMP.more" "$TMP.in"
+	done
+
+	head -c $(($1-1)) "$TMP.in" >"$TMP.more"
+	printf '\n' >>"$TMP.more"
+	mv "$TMP.more" "$TMP.in"
+}
+
+# check name, the output on $TMP.out against the input
+check() {
+	expect "$1 size" "$(wc -c <"$TMP.out")" "$(wc -c <"$TMP.in")"
+	expect "$1 checksum" "$(cksum <"$TMP.out")" "$(cksum <"$TMP.in")"
+}
+
+# Around the first block read from standard input (64 KiB), and 40 MB to grow it a few times
+for size in 65535 65536 65537 40000000; do
+	input $size
+
+	cat "$TMP.in" | "$EAST" -F "$CAT" >"$TMP.out"
+	check "$size bytes from a pipe"
+
+	"$EAST" -F "$CAT" <"$TMP.in" >"$TMP.out"
+	check "$size bytes redirected"
+
+	"$EAST" -F "$CAT" "$TMP.in" >"$TMP.out"
+	check "$size bytes from a file"
+done
+
+finish
@@ -0,0 +1,35 @@
+# Shared by the tests, sourced with the path to east as the first argument (./east by default)
+# Each test runs east with run and compares what it got with expect, finish reports and sets the exit code
+
+EAST=${1:-./east}
+TMP=${TMPDIR:-/tmp}/east-test.$$
+failed=0
+total=0
+
+trap 'rm -f "$TMP".*' EXIT
+
+# run input arguments..., the output, the errors and the exit code end up in out, err and code
+# The input goes through printf, so \n and friends work, and out and err lose their trailing newlines as with $(...)
+run() {
+	printf "$1" >"$TMP.in"
+	shift
+	"$EAST" "$@" <"$TMP.in" >"$TMP.out" 2>"$TMP.err"
+	code=$?
+	out=$(cat "$TMP.out")
+	err=$(cat "$TMP.err")
+}
+
+# expect name got expected
+expect() {
+	total=$((total+1))
+
+	if [ "$2" != "$3" ]; then
+		failed=$((failed+1))
+		printf 'FAIL: %s\nexpected: %s\ngot:      %s\n' "$1" "$3" "$2"
+	fi
+}
+
+finish() {
+	echo "$((total-failed))/$total passed"
+	[ $failed -eq 0 ]
+}
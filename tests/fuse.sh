@@ -0,0 +1,75 @@
+#!/bin/sh
+# Check that the fused idioms (and the checks dropped with them) behave as the instructions they replace
+# Every case runs on every mode, with and without -J, and is compared against the same run with -u
+# Usage: tests/fuse.sh [path/to/east]
+
+EAST=${1:-./east}
+TMP=${TMPDIR:-/tmp}/east-fuse.$$
+failed=0
+total=0
+
+trap 'rm -f "$TMP".*' EXIT
+
+# Run the script with the given flags on the input, keeping the output, the errors and the exit code
+run() {
+	printf "$3" | "$EAST" -$1 "$2" >"$TMP.$4" 2>&1
+	echo "exit $?" >>"$TMP.$4"
+}
+
+# check script input
+check() {
+	for mode in c f d i l; do
+		run "${mode}u" "$1" "$2" expected
+
+		for flags in "" J; do
+			total=$((total+1))
+			run "$mode$flags" "$1" "$2" got
+
+			if ! cmp -s "$TMP.expected" "$TMP.got"; then
+				failed=$((failed+1))
+				echo "FAIL: -$mode$flags '$1' on '$2'"
+				diff "$TMP.expected" "$TMP.got"
+			fi
+		done
+	done
+}
+
+# The idioms themselves
+check '[.>]{;}' 'hello\nworld'
+check '[.;>]' 'hello\nworld'
+check 'abc!@!{;}' ''
+check '\1\1+:' ''
+check '[.\1+;>]' 'abc'
+
+# Empty input and empty data
+check '[.>]{;}' ''
+check '[.;>]' ''
+check '{;}' ''
+check '!@!' ''
+check '\1+:' ''
+
+# Unbalanced brackets
+check '[.>' 'abc'
+check '.>]' 'abc'
+check '[.;>' 'abc'
+check '.;>]' 'abc'
+check '{;' 'abc'
+check ';}' 'abc'
+
+# A `?` that jumps into the middle of an idiom, which then can't be fused
+check '[\x\y?.>]{;}' 'abc'
+check '[\x\x?.>]{;}' 'abc'
+check '[.\x\y?;>]' 'abc'
+check 'abc\x\x?!@!{;}' ''
+check 'abc\x\y?!@!{;}' ''
+check '\1\2?\1+:' ''
+check '\1\1?\1+:' ''
+
+# Reversed data
+check '[.>]!{;}' 'hello'
+check '[.>]!@!{;}' 'hello'
+check 'ab\0cd!{;}' ''
+check '[.>]!\1+{;}' 'abc'
+
+echo "$((total-failed))/$total passed"
+[ $failed -eq 0 ]
@@ -0,0 +1,65 @@
+#!/bin/sh
+# Check that -i and -l wrap around instead of overflowing, and the division rules (by 0, by -1 and truncating towards 0)
+# Usage: tests/integers.sh [path/to/east]
+
+. "$(dirname "$0")/common.sh"
+
+# Script that pushes 2 to the power of n, multiplying by 2 every time
+power() {
+	script='\1'
+	i=0
+
+	while [ $i -lt $1 ]; do
+		script="$script\\2*"
+		i=$((i+1))
+	done
+
+	printf '%s' "$script"
+}
+
+# -1, as 0 - 1
+minus='\0\1-'
+
+# check flags script expected, on the interpreter, the JIT and without fusing
+check() {
+	for engine in "" J u; do
+		run '' -n$1$engine "$2"
+		expect "-$1$engine '$2'" "$out|$err|$code" "$3||0"
+	done
+}
+
+# The lowest and the highest integer of each mode, and wrapping around past them
+for mode in "i 31 2147483647 -2147483648" "l 63 9223372036854775807 -9223372036854775808"; do
+	set -- $mode
+	flag=$1
+	min="$(power $2)"
+	max="$min\\1-"
+
+	check $flag "$min:" "$4"
+	check $flag "$max:" "$3"
+	check $flag "$max\\1+:" "$4"
+	check $flag "$min\\1-:" "$3"
+	check $flag "$max\\2*:" -2
+	check $flag "$(power $(($2+1))):" 0
+	check $flag "$min$minus*:" "$4"
+
+	# The lowest one divided by -1 gives itself, on / and on |/
+	check $flag "$min$minus/:" "$4"
+	check $flag "\\0$min$minus|/:" "$4"
+	check $flag "$max$minus/:" "-$3"
+done
+
+for flag in i l; do
+	# Dividing by 0 divides by 1
+	check $flag '\7\0/:' 7
+	check $flag "\\0\\7-\\0/:" -7
+	check $flag '\0\7\0|/:' 7
+
+	# Truncated towards 0
+	check $flag '\7\2/:' 3
+	check $flag "\\0\\7-\\2/:" -3
+	check $flag "\\7$minus\\2*/:" -3
+	check $flag "\\0\\7-$minus\\2*/:" 3
+done
+
+finish
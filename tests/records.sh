@@ -0,0 +1,33 @@
+#!/bin/sh
+# Check that -L runs the script on every record on its own, an error only stops its record
+# Usage: tests/records.sh [path/to/east]
+
+. "$(dirname "$0")/common.sh"
+
+# `ab` and `xy` fail on the `;`, `c` and `cd` still print
+for workers in "" j1 j4; do
+	run 'ab\nc\nxy\ncd\n' -L$workers '.\c?,;'
+	expect "-L$workers output" "$out" "$(printf '\nc\n\nc')"
+	expect "-L$workers exit code" "$code" 1
+	expect "-L$workers failed records" "$(echo "$err" | grep 'Failed on the record ' | sort)" "$(printf 'East: Failed on the record from byte 0 to 2\nEast: Failed on the record from byte 5 to 7')"
+done
+
+# Nothing fails
+run 'c\ncc\n' -L '.\c?,;'
+expect "no errors output" "$out" "$(printf 'c\nc')"
+expect "no errors exit code" "$code" 0
+
+# Every record fails, each one still gets its line
+run 'a\nb\nc' -L ';'
+expect "all failed output" "$(cat "$TMP.out" | wc -l)" 3
+expect "all failed exit code" "$code" 1
+
+# Records split on commas, with a chunk far bigger than a worker gets
+awk 'BEGIN { for (i = 0; i < 50000; i++) printf "%s,", (i % 1000 == 0) ? "x" : "c" }' >"$TMP.big"
+"$EAST" -L44 '.\c?,;' "$TMP.big" >"$TMP.out" 2>/dev/null
+code=$?
+expect "big input printed records" "$(grep -c c "$TMP.out")" 49950
+expect "big input failed records" "$(grep -c -v c "$TMP.out")" 51
+expect "big input exit code" "$code" 1
+
+finish
@@ -0,0 +1,30 @@
+#!/bin/sh
+# Check the limit of nested calls set with -r, and that tail calls don't count towards it
+# Usage: tests/recursion.sh [path/to/east]
+
+. "$(dirname "$0")/common.sh"
+
+# $a counts the top item down to 0, calling itself once per step, \0, after the call keeps it from being a tail call
+nested='%a,\1-&\0?$a\0,^\5\5*&$a,:'
+tail='%a,\1-&\0?$a^\9\9*\9*\9*\9*\9*&$a,:'
+
+# 25 nested calls need a limit of 25
+for flags in l lJ; do
+	run '' -n${flags}r25 "$nested"
+	expect "-${flags}r25 output" "$out" 0
+	expect "-${flags}r25 exit code" "$code" 0
+
+	run '' -n${flags}r24 "$nested"
+	expect "-${flags}r24 error" "$err" "$(printf 'East, error while interpreting\nCharacter 9 (%s): Recursion limit reached (raise it with -r)' "'\$'")"
+	expect "-${flags}r24 exit code" "$code" 1
+done
+
+# 531441 tail calls, past the default limit of 100000 and far past a limit of 3
+for flags in l lr3 lJr3; do
+	run '' -ns$flags "$tail"
+	expect "-$flags tail calls output" "$out" 0
+	expect "-$flags tail calls exit code" "$code" 0
+	expect "-$flags tail calls" "$(echo "$err" | grep 'calls:')" ' calls: 531441 (531440 tail calls), 2 waypoint stacks allocated'
+done
+
+finish
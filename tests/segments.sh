@@ -0,0 +1,59 @@
+#!/bin/sh
+# Check that every `|` instruction gives the same on the SIMD kernels and on the plain loops, on every mode
+# Usage: tests/segments.sh [path/to/east] [path/to/east built with -DEAST_NO_SIMD]
+
+. "$(dirname "$0")/common.sh"
+
+SCALAR=${2:-./east-nosimd}
+
+if [ ! -x "$SCALAR" ]; then
+	echo "No scalar build on $SCALAR (make nosimd)"
+	exit 1
+fi
+
+# check script input, the output, the errors and the exit code of both builds on every mode
+check() {
+	for mode in c f d i l; do
+		run "$2" -$mode "$1"
+		simd="$out|$err|$code"
+		simd_east=$EAST
+		EAST=$SCALAR
+		run "$2" -$mode "$1"
+		EAST=$simd_east
+		expect "-$mode '$1' on '$2'" "$simd" "$out|$err|$code"
+	done
+}
+
+# Longer than a few vectors, with a tail that doesn't fill one, negative chars and a NUL to split the segments
+text='The quick brown fox jumps over the lazy dog, 0123456789 times\377\200\001'
+long="$text$text$text$text$text"
+split="$text\000$long"
+
+for input in "$text" "$long" "$split" 'a' ''; do
+	# Math with the popped item, dividing by 0 divides by 1
+	for op in + - '*' /; do
+		for item in '\3' '\0' '\1\1-\1-'; do
+			check "[.>]$item|$op{:\ ;}" "$input"
+		done
+	done
+
+	# Reductions, which leave the NUL under the result
+	for op in s '<' '>' c; do
+		check "[.>]|$op{:\ ;}" "$input"
+		check "\\0|$op:" "$input"
+	done
+
+	# Searches move on the input, the rest of it is printed after what they pushed
+	check '\x|f:[.;>]' "$input"
+	check '\0|f:[.;>]' "$input"
+	check '>>>\0\,\9|a:[.;>]' "$input"
+	check '\0|a:[.;>]' "$input"
+done
+
+# Segments under an empty one, and nothing to pop or reduce
+check '\0\0|s:|s:' ''
+check '|+' ''
+check '|s:' ''
+check '|f' ''
+
+finish
@@ -0,0 +1,204 @@
+/*
+ * East: A stack based esolang for data manipulation
+ * Copyright (C) 2021 Bowuigi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Load generator for the server mode, compares the latency of `east -S` against running east once per request
+// Usage: load path/to/east requests script file
+
+// fork, pipe, execvp, waitpid and clock_gettime are POSIX
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define LOAD_ERR(msg) do {fprintf(stderr,"load: %s\n", msg);exit(1);} while (0)
+
+static double Now() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static int CompareTimes(const void *a, const void *b) {
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+// Sort the times and print the percentiles, in microseconds
+static void Report(const char *name, double *times, size_t count) {
+	double total = 0;
+	for (size_t i = 0; i < count; i++)
+		total += times[i];
+
+	qsort(times, count, sizeof(double), CompareTimes);
+	printf("%-10s p50 %10.1f us  p99 %10.1f us  mean %10.1f us\n", name,
+		times[count/2] * 1e6, times[count*99/100] * 1e6, total / count * 1e6);
+}
+
+// Read and drop everything from fd until it ends
+static void Drain(int fd) {
+	char buffer[65536];
+	while (read(fd, buffer, sizeof(buffer)) > 0);
+}
+
+// Read exactly length bytes from fp, NULL for buffer drops them
+static void ReadExact(FILE *fp, char *buffer, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		int c = getc(fp);
+		if (c == EOF)
+			LOAD_ERR("The server stopped");
+		if (buffer)
+			buffer[i] = (char)c;
+	}
+}
+
+// A new process for every request, as a shell script calling east would do
+static void ForkPerCall(char *east, size_t count, char *script, char *file, double *times) {
+	for (size_t i = 0; i < count; i++) {
+		int fds[2];
+		double start = Now();
+
+		if (pipe(fds) != 0)
+			LOAD_ERR("pipe failed");
+
+		pid_t pid = fork();
+		if (pid < 0)
+			LOAD_ERR("fork failed");
+
+		if (pid == 0) {
+			dup2(fds[1], STDOUT_FILENO);
+			close(fds[0]);
+			close(fds[1]);
+			execl(east, east, script, file, (char*)NULL);
+			_exit(127);
+		}
+
+		close(fds[1]);
+		Drain(fds[0]);
+		close(fds[0]);
+		waitpid(pid, NULL, 0);
+
+		times[i] = Now() - start;
+	}
+}
+
+// A single `east -S` answering every request, the script is sent once and then used by id
+static void Server(char *east, size_t count, char *script, char *input, size_t input_length, double *times) {
+	int to[2];
+	int from[2];
+
+	if (pipe(to) != 0 || pipe(from) != 0)
+		LOAD_ERR("pipe failed");
+
+	pid_t pid = fork();
+	if (pid < 0)
+		LOAD_ERR("fork failed");
+
+	if (pid == 0) {
+		dup2(to[0], STDIN_FILENO);
+		dup2(from[1], STDOUT_FILENO);
+		close(to[0]);
+		close(to[1]);
+		close(from[0]);
+		close(from[1]);
+		execl(east, east, "-S", (char*)NULL);
+		_exit(127);
+	}
+
+	close(to[0]);
+	close(from[1]);
+	FILE *out = fdopen(to[1], "w");
+	FILE *in = fdopen(from[0], "r");
+
+	if (!out || !in)
+		LOAD_ERR("fdopen failed");
+
+	size_t id = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		double start = Now();
+
+		if (id)
+			fprintf(out, "c @%zu %zu\n", id, input_length);
+		else
+			fprintf(out, "c %zu %zu\n%s", strlen(script), input_length, script);
+
+		fwrite(input, 1, input_length, out);
+		fflush(out);
+
+		int status;
+		size_t length;
+		if (fscanf(in, "%i %zu %zu", &status, &id, &length) != 3 || getc(in) != '\n')
+			LOAD_ERR("Malformed response");
+
+		ReadExact(in, NULL, length);
+
+		times[i] = Now() - start;
+	}
+
+	fclose(out);
+	fclose(in);
+	waitpid(pid, NULL, 0);
+}
+
+int main(int argc, char **argv) {
+	if (argc != 5) {
+		fprintf(stderr, "Usage: load path/to/east requests script file\n");
+		return 1;
+	}
+
+	size_t count = strtoul(argv[2], NULL, 10);
+	if (count == 0)
+		LOAD_ERR("At least one request is needed");
+
+	FILE *fp = fopen(argv[4], "rb");
+	if (!fp)
+		LOAD_ERR("No such file");
+
+	// The server gets the contents, east the filename
+	size_t input_length = 0;
+	size_t size = 4096;
+	char *input = malloc(size);
+
+	for (size_t n; input && (n = fread(input + input_length, 1, size - input_length, fp)) > 0;) {
+		input_length += n;
+		if (input_length == size)
+			input = realloc(input, size *= 2);
+	}
+
+	double *times = malloc(sizeof(double)*count);
+	if (!input || !times)
+		LOAD_ERR("Out of memory");
+
+	fclose(fp);
+
+	ForkPerCall(argv[1], count, argv[3], argv[4], times);
+	Report("fork/call", times, count);
+
+	Server(argv[1], count, argv[3], input, input_length, times);
+	Report("server", times, count);
+
+	free(input);
+	free(times);
+	return 0;
+}